@@ -0,0 +1,910 @@
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "../ssde/ssde_x86.h"
+#include "../ssde/ssde_x64.h"
+#include "../ssde/ssde_arm.h"
+#include "../ssde/ssde_a64.h"
+#include "../ssde/ssde_riscv.h"
+#include "../ssde/ssde_sweep.h"
+#include "../ssde/ssde_superset.h"
+#include "../ssde/ssde_cfg.h"
+#include "../ssde/ssde_callgraph.h"
+#include "../ssde/ssde_cache.h"
+#include "../ssde/ssde_elf.h"
+#include "../ssde/ssde_pe.h"
+#include "../ssde/ssde_cortex_m.h"
+#include "../ssde/ssde_process.h"
+#include "../ssde/ssde_stream_decoder.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <csignal>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+
+// Decoder throughput benchmark.
+//
+// Usage: ssde_bench [file]
+//
+// The file (the benchmark's own executable by default) is swept from start to
+// end as if it were one long stream of code, so the numbers include whatever
+// data lies in between functions, same as a real linear sweep over an image.
+//
+// On Linux, branch mispredictions per instruction are shown as well if the
+// kernel lets us read hardware counters (see perf_event_paranoid).
+
+using namespace std;
+
+
+namespace
+{
+
+// Counts branch mispredictions of the calling thread
+class Branch_misses
+{
+public:
+	Branch_misses()
+	{
+#ifdef __linux__
+		perf_event_attr attr;
+
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+
+	~Branch_misses()
+	{
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+
+	bool available() const
+	{
+		return fd >= 0;
+	}
+
+	void start()
+	{
+#ifdef __linux__
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	uint64_t stop()
+	{
+		uint64_t count = 0;
+#ifdef __linux__
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+		if (read(fd, &count, sizeof(count)) != sizeof(count))
+			count = 0;
+#endif
+		return count;
+	}
+
+private:
+	int fd = -1;
+};
+
+// Runs sweep until at least half a second has passed and prints how many
+// instructions per second it managed to decode.
+template <typename Sweep>
+void report(const char* name, Sweep sweep)
+{
+	using clock = chrono::steady_clock;
+
+	Branch_misses misses;
+
+	size_t total = 0;
+	double seconds = 0;
+	auto start = clock::now();
+
+	if (misses.available())
+		misses.start();
+
+	do
+	{
+		total += sweep();
+		seconds = chrono::duration<double>(clock::now() - start).count();
+	}
+	while (seconds < 0.5);
+
+	cout << "  " << setfill(' ') << setw(24) << left << name << right
+	     << fixed << setprecision(1) << setw(8)
+	     << total / seconds / 1e6 << " M inst/s";
+
+	if (misses.available())
+	{
+		cout << setprecision(3) << setw(8)
+		     << static_cast<double>(misses.stop()) / total << " misses/inst";
+	}
+
+	cout << "\n";
+}
+
+size_t sweep_inst_x86(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < code.size(); ++count)
+		i += ssde::Inst_x86{code.data(), code.size(), i}.length;
+
+	return count;
+}
+
+size_t sweep_inst_x64(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < code.size(); ++count)
+		i += ssde::Inst_x64{code.data(), code.size(), i}.length;
+
+	return count;
+}
+
+size_t sweep_length_x86(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < code.size(); ++count)
+		i += ssde::x86_length(code.data(), code.size(), i);
+
+	return count;
+}
+
+size_t sweep_length_x64(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < code.size(); ++count)
+		i += ssde::x64_length(code.data(), code.size(), i);
+
+	return count;
+}
+
+size_t sweep_inst_arm(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i + 4 <= code.size(); ++count)
+		i += ssde::Inst_ARM{code.data(), code.size(), i}.length;
+
+	return count;
+}
+
+size_t sweep_inst_thumb(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+	uint8_t it_state = 0;
+
+	for (size_t i = 0; i < code.size(); ++count)
+	{
+		ssde::Inst_ARM inst{code.data(), code.size(), i,
+		                    ssde::Inst_ARM::CPU_state::thumb, it_state};
+
+		it_state = inst.it_state;
+		i += inst.length;
+	}
+
+	return count;
+}
+
+// Same as sweep_range, for thumb_decode_range
+size_t sweep_range_thumb(const vector<uint8_t>& code)
+{
+	const size_t batch = 4096;
+
+	vector<size_t>  offset(batch);
+	vector<uint8_t> length(batch);
+	vector<int64_t> target(batch);
+	vector<uint8_t> has_rel(batch);
+	vector<uint8_t> is_branch(batch);
+	vector<uint8_t> cond(batch);
+	vector<uint8_t> error(batch);
+
+	ssde::Range_thumb out;
+
+	out.offset    = offset.data();
+	out.length    = length.data();
+	out.target    = target.data();
+	out.has_rel   = has_rel.data();
+	out.is_branch = is_branch.data();
+	out.cond      = cond.data();
+	out.error     = error.data();
+	out.capacity  = batch;
+
+	size_t count = 0;
+	size_t pos = 0;
+	uint8_t it_state = 0;
+
+	while (pos < code.size())
+	{
+		size_t n = ssde::thumb_decode_range(code.data(), code.size(), pos,
+		                                    code.size(), out, it_state);
+
+		pos = offset[n - 1] + length[n - 1];
+		count += n;
+	}
+
+	return count;
+}
+
+size_t sweep_inst_a64(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i + 4 <= code.size(); ++count)
+		i += ssde::Inst_A64{code.data(), code.size(), i}.length;
+
+	return count;
+}
+
+// Same as sweep_range, for a64_decode_range
+size_t sweep_range_a64(const vector<uint8_t>& code)
+{
+	const size_t batch = 4096;
+
+	vector<size_t>     offset(batch);
+	vector<int64_t>    target(batch);
+	vector<uint8_t>    has_rel(batch);
+	vector<ssde::Flow> flow(batch);
+	vector<uint8_t>    error(batch);
+
+	ssde::Range_a64 out;
+
+	out.offset   = offset.data();
+	out.target   = target.data();
+	out.has_rel  = has_rel.data();
+	out.flow     = flow.data();
+	out.error    = error.data();
+	out.capacity = batch;
+
+	const size_t end = code.size() & ~size_t(3);
+
+	size_t count = 0;
+
+	for (size_t pos = 0; pos < end; )
+	{
+		size_t n = ssde::a64_decode_range(code.data(), code.size(), pos, end,
+		                                  out);
+
+		pos = offset[n - 1] + 4;
+		count += n;
+	}
+
+	return count;
+}
+
+size_t sweep_inst_riscv(const vector<uint8_t>& code)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < code.size(); ++count)
+		i += ssde::Inst_RISCV{code.data(), code.size(), i}.length;
+
+	return count;
+}
+
+// Same as sweep_range, for riscv_decode_range
+size_t sweep_range_riscv(const vector<uint8_t>& code)
+{
+	const size_t batch = 4096;
+
+	vector<size_t>     offset(batch);
+	vector<uint8_t>    length(batch);
+	vector<int64_t>    target(batch);
+	vector<uint8_t>    has_rel(batch);
+	vector<ssde::Flow> flow(batch);
+	vector<uint8_t>    error(batch);
+
+	ssde::Range_riscv out;
+
+	out.offset   = offset.data();
+	out.length   = length.data();
+	out.target   = target.data();
+	out.has_rel  = has_rel.data();
+	out.flow     = flow.data();
+	out.error    = error.data();
+	out.capacity = batch;
+
+	size_t count = 0;
+
+	for (size_t pos = 0; pos < code.size(); )
+	{
+		size_t n = ssde::riscv_decode_range(code.data(), code.size(), pos,
+		                                    code.size(), out);
+
+		pos = offset[n - 1] + length[n - 1];
+		count += n;
+	}
+
+	return count;
+}
+
+// Sweeps code in batches of up to 4096 instructions at a time
+template <typename Range, typename Decode_range>
+size_t sweep_range(const vector<uint8_t>& code, Decode_range decode_range)
+{
+	const size_t batch = 4096;
+
+	vector<size_t>  offset(batch);
+	vector<uint8_t> length(batch);
+	vector<int64_t> target(batch);
+	vector<uint8_t> has_rel(batch);
+	vector<uint8_t> error(batch);
+
+	Range out;
+
+	out.offset   = offset.data();
+	out.length   = length.data();
+	out.target   = target.data();
+	out.has_rel  = has_rel.data();
+	out.error    = error.data();
+	out.capacity = batch;
+
+	size_t count = 0;
+
+	for (size_t i = 0; i < code.size(); )
+	{
+		size_t n = decode_range(code.data(), code.size(), i, code.size(), out);
+
+		i = offset[n-1] + length[n-1];
+		count += n;
+	}
+
+	return count;
+}
+
+// Sweeps code for instruction boundaries only
+template <typename Predecode>
+size_t sweep_predecode(const vector<uint8_t>& code, Predecode predecode)
+{
+	vector<uint64_t> starts((code.size() + 63) / 64);
+
+	predecode(code.data(), code.size(), 0, code.size(), starts.data());
+
+	size_t count = 0;
+
+	for (uint64_t mask : starts)
+		count += bitset<64>(mask).count();
+
+	return count;
+}
+
+// Code split into small streams of about 64 bytes, in random order, as if
+// they were functions found all over the image
+class Streams_x64
+{
+public:
+	explicit Streams_x64(const vector<uint8_t>& code)
+	{
+		for (size_t i = 0, start = 0; i < code.size(); )
+		{
+			i += ssde::x64_length(code.data(), code.size(), i);
+
+			if (i - start >= 64 || i >= code.size())
+			{
+				ssde::Stream_x64 stream;
+
+				stream.buffer = code.data();
+				stream.size   = code.size();
+				stream.start  = start;
+				stream.end    = i;
+
+				streams.push_back(stream);
+				start = i;
+			}
+		}
+
+		shuffle(streams.begin(), streams.end(), mt19937{});
+
+		// No stream is longer than 64 + 15 bytes
+		offset.resize(streams.size() * 80);
+		length.resize(streams.size() * 80);
+
+		for (size_t i = 0; i < streams.size(); ++i)
+		{
+			streams[i].out.offset   = &offset[i * 80];
+			streams[i].out.length   = &length[i * 80];
+			streams[i].out.capacity = 80;
+		}
+	}
+
+	// Decodes every stream with Inst_x64
+	size_t sweep_inst()
+	{
+		size_t count = 0;
+
+		for (auto& stream : streams)
+		{
+			size_t n = 0;
+
+			for (size_t i = stream.start; i < stream.end; ++n)
+			{
+				ssde::Inst_x64 inst{stream.buffer, stream.size, i};
+
+				stream.out.offset[n] = i;
+				stream.out.length[n] = static_cast<uint8_t>(inst.length);
+				i += inst.length;
+			}
+
+			count += n;
+		}
+
+		return count;
+	}
+
+	size_t sweep_streams()
+	{
+		ssde::x64_decode_streams(streams.data(), streams.size());
+
+		size_t count = 0;
+
+		for (auto& stream : streams)
+			count += stream.count;
+
+		return count;
+	}
+
+private:
+	vector<ssde::Stream_x64> streams;
+	vector<size_t>  offset;
+	vector<uint8_t> length;
+};
+
+// Same sweep as above, split across all cores
+template <typename Parallel_sweep>
+size_t sweep_parallel(const vector<uint8_t>& code,
+                      Parallel_sweep parallel_sweep)
+{
+	return parallel_sweep(code.data(), code.size(), 0, code.size(), 0).size();
+}
+
+// Decodes the instruction at every offset, returns how many were decoded
+template <typename Decode_superset>
+size_t sweep_superset(const vector<uint8_t>& code,
+                      Decode_superset decode_superset)
+{
+	return decode_superset(code.data(), code.size(), 0, code.size(), 0).size();
+}
+
+// Entry points for building a CFG: the first instruction boundary of every
+// 4 KB page, standing in for the function starts of a real image
+vector<size_t> page_entries(const vector<uint8_t>& code)
+{
+	vector<size_t> entries;
+
+	for (size_t i = 0; i < code.size(); )
+	{
+		if (entries.empty() || i / 4096 != entries.back() / 4096)
+			entries.push_back(i);
+
+		i += ssde::x64_length(code.data(), code.size(), i);
+	}
+
+	return entries;
+}
+
+// Builds a CFG from entries, returns how many instructions it decoded
+size_t build_cfg_x64(const vector<uint8_t>& code,
+                     const vector<size_t>& entries, ssde::CFG& cfg)
+{
+	cfg.build_x64(code.data(), code.size(), entries.data(), entries.size());
+	return cfg.inst_count();
+}
+
+// Discovers functions from entries, returns how many instructions were walked
+template <typename Discover_functions>
+size_t discover(const vector<uint8_t>& code, const vector<size_t>& entries,
+                Discover_functions discover_functions, unsigned threads)
+{
+	const ssde::Call_graph graph = discover_functions(code.data(), code.size(),
+	                                                  entries.data(),
+	                                                  entries.size(), threads);
+
+	size_t count = 0;
+
+	for (uint32_t n : graph.inst_count)
+		count += n;
+
+	return count;
+}
+
+// Offsets of the first count instructions, in random order, standing in for
+// the hot addresses an emulator keeps coming back to
+vector<size_t> hot_offsets(const vector<uint8_t>& code, size_t count)
+{
+	vector<size_t> offsets;
+
+	for (size_t i = 0; i < code.size() && offsets.size() < count; )
+	{
+		offsets.push_back(i);
+		i += ssde::x64_length(code.data(), code.size(), i);
+	}
+
+	shuffle(offsets.begin(), offsets.end(), mt19937{});
+
+	return offsets;
+}
+
+// Sweeps the code sections of an image in place, out of the file mapping
+void report_image(const char* format, ssde::Arch arch,
+                  const vector<ssde::Image_section>& sections)
+{
+	cout << format << ", " << sections.size()
+	     << " code sections swept in place\n";
+	report("image_sweep", [&]
+	{
+		size_t count = 0;
+
+		for (const ssde::Image_section& section : sections)
+		{
+			count += ssde::image_sweep(arch, section,
+			                           [](const ssde::Image_batch&) {});
+		}
+
+		return count;
+	});
+}
+
+// Sweeps the code sections of a PE image, then discovers its functions from
+// the entry point, exports and .pdata, one section at a time
+void report_pe(const ssde::Pe_file& pe)
+{
+	const vector<ssde::Image_section>& sections = pe.sections();
+
+	report_image("PE", pe.arch(), sections);
+
+	if (pe.arch() != ssde::Arch::x86 && pe.arch() != ssde::Arch::x64)
+		return;
+
+	const bool x64 = pe.arch() == ssde::Arch::x64;
+	const auto discover_functions = x64 ? ssde::x64_discover_functions :
+	                                      ssde::x86_discover_functions;
+
+	const vector<uint64_t> seeds = pe.seeds();
+
+	// Seeds as offsets into the section they are in
+	vector<vector<size_t>> entries(sections.size());
+
+	for (uint64_t seed : seeds)
+	{
+		const ssde::Image_section* section = pe.find_section(seed);
+
+		if (section != nullptr)
+		{
+			entries[section - sections.data()].push_back(
+				static_cast<size_t>(seed - section->address));
+		}
+	}
+
+	cout << "PE, recursive traversal from " << seeds.size() << " seeds\n";
+	report(x64 ? "x64_discover_functions" : "x86_discover_functions", [&]
+	{
+		size_t count = 0;
+
+		for (size_t i = 0; i < sections.size(); ++i)
+		{
+			if (entries[i].empty())
+				continue;
+
+			const ssde::Call_graph graph = discover_functions(
+				sections[i].data, sections[i].size, entries[i].data(),
+				entries[i].size(), 0);
+
+			for (uint32_t n : graph.inst_count)
+				count += n;
+		}
+
+		return count;
+	});
+}
+
+#ifdef __linux__
+
+// Sweeps the code of a child process, which is a fork of this one, and
+// checks that it decodes the same as sweeping that code here
+bool report_process()
+{
+	pid_t child = fork();
+
+	if (child == 0)
+	{
+		pause();
+		_exit(0);
+	}
+
+	ssde::Process_memory memory;
+
+	bool same = true;
+
+	if (memory.open(child))
+	{
+		using clock = chrono::steady_clock;
+
+		size_t local = 0;
+
+		for (const ssde::Process_region& region : memory.regions())
+		{
+			ssde::Image_section section;
+			section.address = region.start;
+			section.data = reinterpret_cast<const uint8_t*>(region.start);
+			section.size = region.end - region.start;
+
+			local += ssde::image_sweep(memory.arch(), section,
+			                           [](const ssde::Image_batch&) {});
+		}
+
+		same = memory.sweep(memory.arch(),
+		                    [](const ssde::Image_batch&) {}) == local;
+
+		const uint64_t bytes_before = memory.bytes_read();
+
+		size_t total = 0;
+		double seconds = 0;
+		auto start = clock::now();
+
+		do
+		{
+			total += memory.sweep(memory.arch(),
+			                      [](const ssde::Image_batch&) {});
+			seconds = chrono::duration<double>(clock::now() - start).count();
+		}
+		while (seconds < 0.5);
+
+		cout << "child process, " << memory.regions().size()
+		     << " executable regions\n"
+		     << "  " << setw(24) << left << "Process_memory::sweep" << right
+		     << fixed << setprecision(1) << setw(8)
+		     << (memory.bytes_read() - bytes_before) / seconds / 1e6
+		     << " MB/s"
+		     << setw(8) << total / seconds / 1e6 << " M inst/s\n";
+	}
+
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+
+	return same;
+}
+
+#endif
+
+// Feeds code to a stream decoder in chunks of chunk_size bytes
+size_t sweep_chunks_x64(const vector<uint8_t>& code, size_t chunk_size)
+{
+	ssde::Stream_decoder_x64 decoder;
+
+	size_t count = 0;
+	auto visit = [](const ssde::Inst_x64&, uint64_t) {};
+
+	for (size_t pos = 0; pos < code.size(); pos += chunk_size)
+	{
+		count += decoder.feed(code.data() + pos,
+		                      min(chunk_size, code.size() - pos), visit);
+	}
+
+	return count + decoder.finish(visit);
+}
+
+// Checks that the parallel sweep agrees with the sequential one
+template <typename Range, typename Decode_range, typename Parallel_sweep>
+bool same_sweep(const vector<uint8_t>& code, Decode_range decode_range,
+                Parallel_sweep parallel_sweep)
+{
+	// Many chunks, so that there are boundaries to stitch
+	const ssde::Sweep sweep = parallel_sweep(code.data(), code.size(), 0,
+	                                         code.size(), 64);
+
+	vector<size_t>  offset(sweep.size() + 1);
+	vector<uint8_t> length(sweep.size() + 1);
+	vector<int64_t> target(sweep.size() + 1);
+	vector<uint8_t> has_rel(sweep.size() + 1);
+	vector<uint8_t> error(sweep.size() + 1);
+
+	Range out;
+
+	out.offset   = offset.data();
+	out.length   = length.data();
+	out.target   = target.data();
+	out.has_rel  = has_rel.data();
+	out.error    = error.data();
+	out.capacity = offset.size();
+
+	size_t n = decode_range(code.data(), code.size(), 0, code.size(), out);
+
+	return n == sweep.size() &&
+	       equal(sweep.offset.begin(),  sweep.offset.end(),  offset.begin()) &&
+	       equal(sweep.length.begin(),  sweep.length.end(),  length.begin()) &&
+	       equal(sweep.target.begin(),  sweep.target.end(),  target.begin()) &&
+	       equal(sweep.has_rel.begin(), sweep.has_rel.end(), has_rel.begin()) &&
+	       equal(sweep.error.begin(),   sweep.error.end(),   error.begin());
+}
+
+} // namespace
+
+
+int main(int argc, const char* argv[])
+{
+	ios::sync_with_stdio(false);
+
+	const char* path = argc > 1 ? argv[1] : argv[0];
+	ifstream file(path, ios::binary);
+
+	const vector<uint8_t> code{istreambuf_iterator<char>(file),
+	                           istreambuf_iterator<char>()};
+
+	if (code.empty())
+	{
+		cerr << "can't read " << path << "\n";
+		return 1;
+	}
+
+	cout << path << ": " << code.size() << " bytes\n";
+
+	cout << "x86\n";
+	report("Inst_x86",   [&] { return sweep_inst_x86(code); });
+	report("x86_length", [&] { return sweep_length_x86(code); });
+	report("x86_decode_range", [&]
+	{
+		return sweep_range<ssde::Range_x86>(code, ssde::x86_decode_range);
+	});
+	report("x86_predecode", [&]
+	{
+		return sweep_predecode(code, ssde::x86_predecode);
+	});
+	report("x86_parallel_sweep", [&]
+	{
+		return sweep_parallel(code, ssde::x86_parallel_sweep);
+	});
+	report("x86_decode_superset", [&]
+	{
+		return sweep_superset(code, ssde::x86_decode_superset);
+	});
+
+	cout << "x64\n";
+	report("Inst_x64",   [&] { return sweep_inst_x64(code); });
+	report("x64_length", [&] { return sweep_length_x64(code); });
+	report("x64_decode_range", [&]
+	{
+		return sweep_range<ssde::Range_x64>(code, ssde::x64_decode_range);
+	});
+	report("x64_predecode", [&]
+	{
+		return sweep_predecode(code, ssde::x64_predecode);
+	});
+	report("x64_parallel_sweep", [&]
+	{
+		return sweep_parallel(code, ssde::x64_parallel_sweep);
+	});
+	report("x64_decode_superset", [&]
+	{
+		return sweep_superset(code, ssde::x64_decode_superset);
+	});
+
+	cout << "A32\n";
+	report("Inst_ARM", [&] { return sweep_inst_arm(code); });
+
+	cout << "A64\n";
+	report("Inst_A64", [&] { return sweep_inst_a64(code); });
+	report("a64_decode_range", [&] { return sweep_range_a64(code); });
+
+	cout << "RV64GC\n";
+	report("Inst_RISCV", [&] { return sweep_inst_riscv(code); });
+	report("riscv_decode_range", [&] { return sweep_range_riscv(code); });
+
+	cout << "Thumb\n";
+	report("Inst_ARM", [&] { return sweep_inst_thumb(code); });
+	report("thumb_decode_range", [&] { return sweep_range_thumb(code); });
+
+	cout << "x64, fed in 4 KB chunks\n";
+	report("Stream_decoder_x64", [&] { return sweep_chunks_x64(code, 4096); });
+
+	Streams_x64 streams{code};
+
+	cout << "x64, 64 byte streams in random order\n";
+	report("Inst_x64",   [&] { return streams.sweep_inst(); });
+	report("x64_decode_streams", [&] { return streams.sweep_streams(); });
+
+	const vector<size_t> hot = hot_offsets(code, 4096);
+	ssde::Decode_cache_x64 cache;
+
+	cout << "x64, " << hot.size() << " hot instructions decoded again and again\n";
+	report("Inst_x64", [&]
+	{
+		size_t count = 0;
+
+		for (size_t pos : hot)
+			count += ssde::Inst_x64(code.data(), code.size(), pos).length != 0;
+
+		return count;
+	});
+	report("Decode_cache_x64", [&]
+	{
+		size_t count = 0;
+
+		for (size_t pos : hot)
+			count += cache.decode(code.data(), code.size(), pos).length() != 0;
+
+		return count;
+	});
+
+	const vector<size_t> entries = page_entries(code);
+	ssde::CFG cfg;
+
+	cout << "x64, recursive traversal from " << entries.size() << " entries\n";
+	report("CFG::build_x64", [&] { return build_cfg_x64(code, entries, cfg); });
+	report("x64_discover_functions/1", [&]
+	{
+		return discover(code, entries, ssde::x64_discover_functions, 1);
+	});
+	report("x64_discover_functions", [&]
+	{
+		return discover(code, entries, ssde::x64_discover_functions, 0);
+	});
+
+	ssde::Elf_file elf;
+	ssde::Pe_file pe;
+	ssde::Cortex_m_firmware firmware;
+
+	if (elf.open(path))
+		report_image("ELF", elf.arch(), elf.sections());
+	else if (pe.open(path))
+		report_pe(pe);
+	else if (firmware.open(path))
+	{
+		cout << "Cortex-M firmware, traversal from "
+		     << firmware.vectors().size() << " handlers\n";
+		report("Cortex_m_firmware", [&]
+		{
+			return firmware.traverse().inst_count;
+		});
+		report("Inst_ARM (thumb sweep)", [&]
+		{
+			return sweep_inst_thumb(code);
+		});
+	}
+
+#ifdef __linux__
+	if (!report_process())
+	{
+		cerr << "process sweep doesn't match sweep of the same code\n";
+		return 1;
+	}
+#endif
+
+	if (!same_sweep<ssde::Range_x86>(code, ssde::x86_decode_range,
+	                                 ssde::x86_parallel_sweep) ||
+	    !same_sweep<ssde::Range_x64>(code, ssde::x64_decode_range,
+	                                 ssde::x64_parallel_sweep))
+	{
+		cerr << "parallel sweep doesn't match linear sweep\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -8,6 +8,16 @@
 #include "../ssde/ssde_arm.h"
 
 
+// Lengths of a hook's trampoline, checked at compile time
+constexpr uint8_t jmp_rel32[] = { 0xe9, 0x00, 0x10, 0x00, 0x00 };
+constexpr uint8_t mov_rax_imm64[] = { 0x48, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static_assert(ssde::x86_length(jmp_rel32) == 5, "");
+static_assert(ssde::x64_decode_length(jmp_rel32).rel == 0x1005, "");
+static_assert(ssde::x64_length(mov_rax_imm64) == 10, "");
+static_assert(ssde::x86_length(mov_rax_imm64) == 1, ""); // dec eax
+
+
 int main(int argc, const char* argv[])
 {
 	using namespace std;
@@ -0,0 +1,332 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// SSDE implementation for AArch64
+#include "ssde_a64.h"
+#include "ssde_arm_tables.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SSDE_SSE2
+#endif
+
+
+using ssde::Inst_A64;
+using ssde::Range_a64;
+using ssde::Flow;
+namespace a64 = ssde::detail::a64;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::int32_t;
+using std::int64_t;
+using std::uint64_t;
+
+
+namespace
+{
+
+const uint8_t error_eof       = static_cast<uint8_t>(Inst_A64::Error::eof);
+const uint8_t error_alignment = static_cast<uint8_t>(Inst_A64::Error::alignment);
+const uint8_t error_opcode    = static_cast<uint8_t>(Inst_A64::Error::opcode);
+
+const uint8_t cond_al = static_cast<uint8_t>(Inst_A64::Cond::al);
+
+// Flow of BR, BLR, RET, ERET and DRPS by opc (bits 24..21)
+const Flow branch_reg_flow[16] =
+{
+	Flow::jump, Flow::call, Flow::ret,  Flow::stop,
+	Flow::ret,  Flow::ret,  Flow::stop, Flow::stop,
+	Flow::jump, Flow::call, Flow::stop, Flow::stop,
+	Flow::stop, Flow::stop, Flow::stop, Flow::stop,
+};
+
+struct Word
+{
+	Flow flow = Flow::none;
+	uint8_t cond = cond_al;
+	uint8_t error = 0;
+	bool has_rel = false;
+	bool is_swi = false;
+	int64_t rel = 0;
+	int32_t swi_data = 0;
+};
+
+inline uint32_t fetch32(const uint8_t* buffer, size_t pos)
+{
+	return buffer[pos] |
+	       static_cast<uint32_t>(buffer[pos + 1]) << 8 |
+	       static_cast<uint32_t>(buffer[pos + 2]) << 16 |
+	       static_cast<uint32_t>(buffer[pos + 3]) << 24;
+}
+
+// Signed field of width bits at bit lsb, times 4
+inline int64_t word_offset(uint32_t w, int lsb, int width)
+{
+	return static_cast<int64_t>(static_cast<int32_t>(w << (32 - lsb - width)) >>
+	                            (32 - width)) * 4;
+}
+
+// address is that of buffer[0], pos is relative to it
+inline Word decode_word(uint32_t w, size_t pos, uint64_t address)
+{
+	Word r;
+
+	switch (a64::table[w >> 24])
+	{
+	case a64::b:
+		r.flow = Flow::jump;
+		r.has_rel = true;
+		r.rel = word_offset(w, 0, 26);
+		break;
+
+	case a64::bl:
+		r.flow = Flow::call;
+		r.has_rel = true;
+		r.rel = word_offset(w, 0, 26);
+		break;
+
+	case a64::bc:
+		r.cond = static_cast<uint8_t>(w & 0xf);
+		r.flow = r.cond >= cond_al ? Flow::jump : Flow::branch;
+		r.has_rel = true;
+		r.rel = word_offset(w, 5, 19);
+		break;
+
+	case a64::cb:
+		r.flow = Flow::branch;
+		r.has_rel = true;
+		r.rel = word_offset(w, 5, 19);
+		break;
+
+	case a64::tb:
+		r.flow = Flow::branch;
+		r.has_rel = true;
+		r.rel = word_offset(w, 5, 14);
+		break;
+
+	case a64::adr:
+	case a64::adrp:
+	{
+		int64_t imm = static_cast<int32_t>(((w >> 3) & 0x1ffffc) << 11 |
+		                                   ((w >> 29) & 3) << 11) >> 11;
+		r.has_rel = true;
+
+		if (a64::table[w >> 24] == a64::adr)
+		{
+			r.rel = imm;
+		}
+		else
+		{
+			// Relative to the 4 KB page the instruction is in
+			r.rel = imm * 4096 - static_cast<int64_t>((address + pos) & 0xfff);
+		}
+		break;
+	}
+
+	case a64::exc:
+		switch ((w >> 21) & 7) // opc
+		{
+		case 0: // SVC, HVC, SMC
+			if (w & 3)
+			{
+				r.is_swi = true;
+				r.swi_data = static_cast<int32_t>((w >> 5) & 0xffff);
+			}
+			else
+			{
+				r.error |= error_opcode;
+			}
+			break;
+
+		case 1: // BRK
+		case 2: // HLT
+			r.flow = Flow::stop;
+			break;
+
+		default: // DCPS
+			break;
+		}
+		break;
+
+	case a64::br:
+		r.flow = branch_reg_flow[(w >> 21) & 0xf];
+
+		if (r.flow == Flow::stop || ((w >> 16) & 0x1f) != 0x1f)
+		{
+			r.flow = Flow::stop;
+			r.error |= error_opcode;
+		}
+		break;
+
+	case a64::udf:
+		if ((w & 0x00ff0000) == 0)
+		{
+			r.flow = Flow::stop;
+			r.error |= error_opcode;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (pos % 4 != 0)
+		r.error |= error_alignment;
+
+	return r;
+}
+
+inline Word decode_at(const uint8_t* buffer, size_t size, size_t pos,
+                      uint64_t address)
+{
+	if (pos > size || size - pos < 4)
+	{
+		Word r;
+		r.flow = Flow::stop;
+		r.error = error_eof;
+
+		if (pos % 4 != 0)
+			r.error |= error_alignment;
+
+		return r;
+	}
+
+	return decode_word(fetch32(buffer, pos), pos, address);
+}
+
+inline void store(const Range_a64& out, size_t i, size_t pos, const Word& r)
+{
+	out.offset[i]  = pos;
+	out.target[i]  = static_cast<int64_t>(pos) + r.rel;
+	out.has_rel[i] = r.has_rel;
+	out.flow[i]    = r.flow;
+	out.error[i]   = r.error;
+}
+
+// Instruction that can't branch or form an address
+inline void store_plain(const Range_a64& out, size_t i, size_t pos)
+{
+	out.offset[i]  = pos;
+	out.target[i]  = static_cast<int64_t>(pos);
+	out.has_rel[i] = 0;
+	out.flow[i]    = Flow::none;
+	out.error[i]   = 0;
+}
+
+#ifdef SSDE_SSE2
+
+// Bit n is set if word n of the 16 bytes at words may be anything but a
+// plain instruction (a64::no in the class table). Unlike the table, this
+// also picks up system instructions (D5) and words with a zero top byte,
+// which decode_word sorts out.
+inline uint32_t interesting(const uint8_t* words)
+{
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words));
+
+	auto is = [&v](uint32_t mask, uint32_t value)
+	{
+		return _mm_cmpeq_epi32(
+			_mm_and_si128(v, _mm_set1_epi32(static_cast<int32_t>(mask))),
+			_mm_set1_epi32(static_cast<int32_t>(value)));
+	};
+
+	const __m128i any = _mm_or_si128(
+		_mm_or_si128(_mm_or_si128(is(0x1f000000, 0x10000000),   // ADR, ADRP
+		                          is(0x7c000000, 0x14000000)),   // B, BL
+		             _mm_or_si128(is(0xff000000, 0x54000000),    // B.cond
+		                          is(0x7c000000, 0x34000000))),  // CBZ, TBZ
+		_mm_or_si128(is(0xfc000000, 0xd4000000),                 // SVC, BR
+		             is(0xff000000, 0x00000000)));               // UDF
+
+	return static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(any)));
+}
+
+#endif // SSDE_SSE2
+
+} // namespace
+
+
+Inst_A64::Inst_A64(const uint8_t* buffer, size_t size, size_t pos,
+                   uint64_t address)
+{
+	const Word r = decode_at(buffer, size, pos, address);
+
+	length   = 4;
+	opcode   = r.error & error_eof ? 0 : fetch32(buffer, pos);
+	flow     = r.flow;
+	cond     = static_cast<Cond>(r.cond);
+	has_rel  = r.has_rel;
+	rel      = r.rel;
+	is_swi   = r.is_swi;
+	swi_data = r.swi_data;
+
+	error_flags = r.error;
+}
+
+size_t ssde::a64_decode_range(const uint8_t* buffer, size_t size,
+                              size_t start, size_t end, const Range_a64& out,
+                              uint64_t address)
+{
+	if (end > size)
+		end = size;
+
+	size_t pos = start;
+	size_t count = 0;
+
+#ifdef SSDE_SSE2
+	// Four words at a time. Misaligned code would have every instruction
+	// flagged, so it is left to the loop below.
+	if (pos % 4 == 0)
+	{
+		while (pos < end && end - pos >= 16 && out.capacity - count >= 4)
+		{
+			uint32_t flagged = interesting(buffer + pos);
+
+			for (size_t i = 0; i < 4; ++i)
+			{
+				if (flagged >> i & 1)
+					store(out, count + i, pos + i * 4,
+					      decode_word(fetch32(buffer, pos + i * 4),
+					                  pos + i * 4, address));
+				else
+					store_plain(out, count + i, pos + i * 4);
+			}
+
+			pos += 16;
+			count += 4;
+		}
+	}
+#endif
+
+	while (pos < end && count < out.capacity)
+	{
+		store(out, count, pos, decode_at(buffer, size, pos, address));
+
+		pos += 4;
+		++count;
+	}
+
+	return count;
+}
@@ -0,0 +1,147 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_A64_H
+#define SSDE_A64_H
+
+#include "ssde_cfg.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// AArch64 instructions are all 4 bytes long. Like Inst_ARM, a misaligned pos
+// signals Error::alignment, but the word there is still decoded.
+
+namespace ssde
+{
+
+// AArch64 (A64) instruction. Only what matters for following control flow is
+// extracted: how the instruction passes control on, its condition and the
+// target of PC relative branches and address computations.
+class Inst_A64
+{
+public:
+	enum class Error : std::uint8_t
+	{
+		eof       = 1 << 0, // Reached end of buffer before finished decoding
+		alignment = 1 << 1, // PC is misaligned
+		opcode    = 1 << 2, // Badly encoded instruction
+	};
+
+	enum class Cond : std::uint8_t // condition of B.cond
+	{
+		eq = 0x0,
+		ne = 0x1,
+		hs = 0x2,
+		lo = 0x3,
+		mi = 0x4,
+		pl = 0x5,
+		vs = 0x6,
+		vc = 0x7,
+		hi = 0x8,
+		ls = 0x9,
+		ge = 0xa,
+		lt = 0xb,
+		gt = 0xc,
+		le = 0xd,
+		al = 0xe,
+		nv = 0xf,
+	};
+
+
+	Inst_A64()
+	{
+	}
+
+	// address is where buffer[0] is loaded, see rel
+	Inst_A64(const std::uint8_t* buffer, std::size_t size,
+	         std::size_t in_pos = 0, std::uint64_t address = 0);
+
+	Inst_A64(const std::vector<std::uint8_t>& buffer,
+	         std::size_t in_pos = 0, std::uint64_t address = 0) :
+		Inst_A64(buffer.data(), buffer.size(), in_pos, address)
+	{
+	}
+
+	bool has_error(Error signal) const
+	{
+		return (error_flags & static_cast<std::uint8_t>(signal)) ? true : false;
+	}
+
+	bool has_error() const
+	{
+		return error_flags != 0;
+	}
+
+
+	std::int32_t length = 0;
+
+	std::uint32_t opcode = 0; // the instruction word
+
+	// B.cond, CBZ, CBNZ, TBZ and TBNZ are Flow::branch, B and BR jumps, BL
+	// and BLR calls, RET and ERET returns. BRK, HLT, UDF and anything that
+	// failed to decode are Flow::stop.
+	Flow flow = Flow::none;
+
+	// Condition of B.cond, al for anything else
+	Cond cond = Cond::al;
+
+	// Set for B, BL, B.cond, CBZ, CBNZ, TBZ, TBNZ, which branch to pos + rel,
+	// and ADR and ADRP, which put pos + rel in a register (flow is none).
+	// ADRP counts from the start of the 4 KB page of address + pos, so its
+	// rel is only right if the address of the buffer was passed in.
+	bool has_rel = false;
+	// abs = pos + rel
+	std::int64_t rel = 0;
+
+	bool is_swi = false; // SVC, HVC, SMC
+	std::int32_t swi_data = 0;
+
+protected:
+	std::uint8_t error_flags = 0;
+};
+
+
+// Struct-of-arrays output of a64_decode_range, in the manner of Range_x64.
+// Arrays are owned by the caller and must have room for capacity entries.
+// Every instruction is 4 bytes long, so there is no length column.
+struct Range_a64
+{
+	std::size_t*  offset  = nullptr; // where instruction starts
+	std::int64_t* target  = nullptr; // offset + rel, valid if has_rel is set
+	std::uint8_t* has_rel = nullptr;
+	Flow*         flow    = nullptr;
+	std::uint8_t* error   = nullptr; // Inst_A64::Error flags
+	std::size_t   capacity = 0;
+};
+
+// Linear sweep over [start, end) of buffer, with the same result as decoding
+// Inst_A64s one after another. Words are classified several at a time with
+// SIMD compares, and only those that may branch or form an address are
+// decoded further. Returns how many instructions were written. address is
+// where buffer[0] is loaded, as for Inst_A64.
+std::size_t a64_decode_range(const std::uint8_t* buffer, std::size_t size,
+                             std::size_t start, std::size_t end,
+                             const Range_a64& out, std::uint64_t address = 0);
+
+} // namespace ssde
+
+#endif // SSDE_A64_H
@@ -0,0 +1,86 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "ssde_arena.h"
+#include <cstddef>
+#include <memory>
+
+
+using ssde::Arena;
+using std::size_t;
+
+
+namespace
+{
+
+const size_t min_block_size = 64 * 1024;
+
+} // namespace
+
+
+void Arena::clear()
+{
+	block = 0;
+	current = nullptr;
+	used = 0;
+	capacity = 0;
+}
+
+size_t Arena::reserved() const
+{
+	size_t total = 0;
+
+	for (const Block& b : blocks)
+		total += b.size;
+
+	return total;
+}
+
+void* Arena::grow(size_t size, size_t align)
+{
+	// Blocks are allocated with new[], which aligns them for any type
+	const size_t needed = size + align;
+
+	// Reuse blocks left over from before clear() if they are big enough
+	while (block < blocks.size() && blocks[block].size < needed)
+		++block;
+
+	if (block == blocks.size())
+	{
+		size_t block_size = min_block_size;
+
+		// Grow geometrically, so that big structures take few blocks
+		if (!blocks.empty())
+			block_size = blocks.back().size * 2;
+
+		if (block_size < needed)
+			block_size = needed;
+
+		blocks.push_back(Block{std::unique_ptr<char[]>(new char[block_size]),
+		                       block_size});
+	}
+
+	current  = blocks[block].data.get();
+	capacity = blocks[block].size;
+	used     = 0;
+	++block;
+
+	return allocate(size, align);
+}
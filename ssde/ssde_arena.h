@@ -0,0 +1,92 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_ARENA_H
+#define SSDE_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+namespace ssde
+{
+
+// Bump allocator for objects that all die together. Memory is taken from
+// blocks of at least 64 KB, which are kept by clear() and reused, so that
+// rebuilding a structure of the same size allocates nothing.
+// Only meant for trivially destructible types, destructors are never run.
+class Arena
+{
+public:
+	Arena()
+	{
+	}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	Arena(Arena&&) = default;
+	Arena& operator=(Arena&&) = default;
+
+	void* allocate(std::size_t size, std::size_t align)
+	{
+		std::size_t start = (used + align - 1) & ~(align - 1);
+
+		if (start + size > capacity)
+			return grow(size, align);
+
+		used = start + size;
+		return current + start;
+	}
+
+	// Uninitialized array of count Ts
+	template <typename T>
+	T* allocate(std::size_t count)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Forgets all allocations, keeping the memory
+	void clear();
+
+	// Bytes taken from the system so far
+	std::size_t reserved() const;
+
+private:
+	void* grow(std::size_t size, std::size_t align);
+
+	struct Block
+	{
+		std::unique_ptr<char[]> data;
+		std::size_t size;
+	};
+
+	std::vector<Block> blocks;
+	std::size_t block = 0; // blocks[block - 1] is the current one
+
+	char* current = nullptr;
+	std::size_t used = 0;
+	std::size_t capacity = 0;
+};
+
+} // namespace ssde
+
+#endif // SSDE_ARENA_H
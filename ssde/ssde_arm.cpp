@@ -21,12 +21,16 @@
 //
 // SSDE implementation for ARM arch
 #include "ssde_arm.h"
+#include "ssde_arm_tables.h"
 #include <cstdint>
 #include <cstddef>
 #include <vector>
 
 
 using ssde::Inst_ARM;
+using ssde::Range_thumb;
+namespace a32 = ssde::detail::a32;
+namespace t16 = ssde::detail::t16;
 using std::vector;
 using std::size_t;
 using std::uint8_t;
@@ -37,88 +41,649 @@ using std::int16_t;
 using std::int32_t;
 
 
-void Inst_ARM::internal_decode(const vector<uint8_t>& buffer,
-                               CPU_state state)
+namespace
 {
-	switch (state)
+
+inline uint8_t reg(uint32_t bc, int lsb)
+{
+	return static_cast<uint8_t>((bc >> lsb) & 0xf);
+}
+
+// 8 bit constant rotated right by twice the 4 bit rotation
+inline uint32_t rotated_imm(uint32_t bc)
+{
+	uint32_t imm8 = bc & 0xff;
+	uint32_t rot = (bc >> 7) & 0x1e;
+
+	return rot ? (imm8 >> rot) | (imm8 << (32 - rot)) : imm8;
+}
+
+// Offset of a load or store, negated unless U (bit 23) is set
+inline uint32_t signed_offset(uint32_t bc, uint32_t offset)
+{
+	return (bc & 0x00800000) ? offset : 0 - offset;
+}
+
+// Branch offset in words, relative to PC (pos + 8)
+inline int32_t branch_rel(uint32_t bc)
+{
+	return (static_cast<int32_t>(bc << 8) >> 6) + 8;
+}
+
+// Data processing opcodes (bits 24..21) that write Rd and that read Rn
+const uint16_t dp_writes_rd = 0xf0ff; // all but TST, TEQ, CMP, CMN
+const uint16_t dp_reads_rn  = 0x5fff; // all but MOV, MVN
+
+const uint8_t error_eof       = static_cast<uint8_t>(Inst_ARM::Error::eof);
+const uint8_t error_alignment = static_cast<uint8_t>(Inst_ARM::Error::alignment);
+const uint8_t error_opcode    = static_cast<uint8_t>(Inst_ARM::Error::opcode);
+
+const uint8_t cond_al = static_cast<uint8_t>(Inst_ARM::Exec_cond::al);
+
+// What a Thumb instruction does to control flow
+struct Thumb_flow
+{
+	uint8_t length = 2;
+	uint8_t cond = cond_al;
+	uint8_t it_state = 0; // after the instruction
+	uint8_t error = 0;
+
+	bool is_branch = false;
+	bool has_link  = false;
+	bool has_rel   = false;
+	bool is_swi    = false;
+
+	int32_t rel = 0;
+	int32_t swi_data = 0;
+};
+
+inline uint32_t fetch16(const uint8_t* buffer, size_t pos)
+{
+	return buffer[pos] | static_cast<uint32_t>(buffer[pos + 1]) << 8;
+}
+
+// Branch offset of the 32 bit B<c> (T3), before PC is added
+inline int32_t thumb_rel_t3(uint32_t hw1, uint32_t hw2)
+{
+	uint32_t imm = (hw1 & 0x0400) << 10 | (hw2 & 0x0800) << 8 |
+	               (hw2 & 0x2000) << 5  | (hw1 & 0x003f) << 12 |
+	               (hw2 & 0x07ff) << 1;
+
+	return static_cast<int32_t>(imm << 11) >> 11;
+}
+
+// Branch offset of B, BL and BLX (T4), before PC is added
+inline int32_t thumb_rel_t4(uint32_t hw1, uint32_t hw2)
+{
+	uint32_t s  = (hw1 >> 10) & 1;
+	uint32_t i1 = ~((hw2 >> 13) ^ s) & 1;
+	uint32_t i2 = ~((hw2 >> 11) ^ s) & 1;
+	uint32_t imm = s << 24 | i1 << 23 | i2 << 22 |
+	               (hw1 & 0x03ff) << 12 | (hw2 & 0x07ff) << 1;
+
+	return static_cast<int32_t>(imm << 7) >> 7;
+}
+
+void decode_thumb_wide(uint32_t hw1, uint32_t hw2, size_t pos, Thumb_flow& f)
+{
+	switch (((hw1 >> 11) & 3) << 1 | hw2 >> 15)
 	{
-	case CPU_state::arm:
-		decode_as_arm(fetch(buffer, 4));
+	case 1 << 1 | 0: // load/store multiple, dual, exclusive, table branch
+	case 1 << 1 | 1:
+		// LDM, POP and RFE that load PC
+		if ((hw1 & 0xfe50) == 0xe810 && (hw2 & 0x8000))
+			f.is_branch = true;
+
+		// TBB, TBH
+		if ((hw1 & 0xfff0) == 0xe8d0 && (hw2 & 0xffe0) == 0xf000)
+			f.is_branch = true;
 		break;
 
-	case CPU_state::thumb:
+	case 2 << 1 | 1: // branches and miscellaneous control
+		if (hw2 & 0x1000) // B, BL
+		{
+			f.is_branch = true;
+			f.has_link = (hw2 & 0x4000) != 0;
+			f.has_rel = true;
+			f.rel = thumb_rel_t4(hw1, hw2) + 4;
+		}
+		else if (hw2 & 0x4000) // BLX, the target is aligned to 4
+		{
+			f.is_branch = true;
+			f.has_link = true;
+			f.has_rel = true;
+			f.rel = thumb_rel_t4(hw1, hw2) + 4 - static_cast<int32_t>(pos & 2);
+
+			if (hw2 & 1)
+				f.error |= error_opcode;
+		}
+		else if ((hw1 & 0x0380) != 0x0380) // B<c>
+		{
+			f.is_branch = true;
+			f.has_rel = true;
+			f.rel = thumb_rel_t3(hw1, hw2) + 4;
+			f.cond = static_cast<uint8_t>((hw1 >> 6) & 0xf);
+		}
+		else if ((hw1 & 0xfff0) == 0xf3c0 || hw1 == 0xf3de) // BXJ, ERET
+		{
+			f.is_branch = true;
+		}
+		else if ((hw1 & 0xfff0) == 0xf7f0 && (hw2 & 0xf000) == 0xa000) // UDF
+		{
+			f.error |= error_opcode;
+		}
+		break;
+
+	case 3 << 1 | 0: // LDR PC
+	case 3 << 1 | 1:
+		if ((hw1 & 0xff70) == 0xf850 && (hw2 >> 12) == 0xf)
+			f.is_branch = true;
 		break;
 
 	default:
-		signal_error(Error::cpu_state);
 		break;
 	}
 }
 
-void Inst_ARM::decode_as_arm(uint32_t bc)
+// Decodes the Thumb instruction at pos. it_state is the IT state left by the
+// previous instruction.
+inline Thumb_flow decode_thumb(const uint8_t* buffer, size_t size, size_t pos,
+                               uint8_t it_state)
 {
-	if ((bc & 0x0c000000) == 0x00000000)
-	{
-		// Data processing / PSR Transfer
-	}
-	else if ((bc & 0x0fc000f0) == 0x00000090)
-	{
-		// Multiply
-	}
-	else if ((bc & 0x0f8000f0) == 0x00800090)
+	Thumb_flow f;
+
+	if (pos % 2 != 0)
+		f.error |= error_alignment;
+
+	if (pos > size || size - pos < 2)
 	{
-		// Long Multiply (v3M / v4 only)
+		f.error |= error_eof;
+		f.it_state = it_state;
+		return f;
 	}
-	else if ((bc & 0x0fb00ff0) == 0x01000090)
+
+	const uint32_t hw1 = fetch16(buffer, pos);
+	bool is_it = false;
+
+	switch (t16::table[hw1 >> 10])
 	{
-		// Swap
+	case t16::hi_reg:
+		if ((hw1 & 0x0300) == 0x0300) // BX, BLX
+		{
+			f.is_branch = true;
+			f.has_link = (hw1 & 0x0080) != 0;
+		}
+		else if ((hw1 & 0x0087) == 0x0087 && (hw1 & 0x0300) != 0x0100)
+		{
+			// ADD PC, MOV PC
+			f.is_branch = true;
+		}
+		break;
+
+	case t16::misc:
+		if ((hw1 & 0x0500) == 0x0100) // CBZ, CBNZ
+		{
+			f.is_branch = true;
+			f.has_rel = true;
+			f.rel = static_cast<int32_t>(((hw1 >> 3) & 0x40) |
+			                             ((hw1 >> 2) & 0x3e)) + 4;
+		}
+		else if ((hw1 & 0x0f00) == 0x0d00) // POP with PC
+		{
+			f.is_branch = true;
+		}
+		else if ((hw1 & 0x0f00) == 0x0f00 && (hw1 & 0x000f)) // IT
+		{
+			is_it = true;
+		}
+		break;
+
+	case t16::cond:
+		switch ((hw1 >> 8) & 0xf)
+		{
+		case 0xe: // UDF
+			f.error |= error_opcode;
+			break;
+
+		case 0xf: // SVC
+			f.is_swi = true;
+			f.swi_data = static_cast<int32_t>(hw1 & 0xff);
+			break;
+
+		default:
+			f.is_branch = true;
+			f.has_rel = true;
+			f.rel = static_cast<int8_t>(hw1) * 2 + 4;
+			f.cond = static_cast<uint8_t>((hw1 >> 8) & 0xf);
+			break;
+		}
+		break;
+
+	case t16::branch:
+		f.is_branch = true;
+		f.has_rel = true;
+		f.rel = (static_cast<int32_t>(hw1 << 21) >> 20) + 4;
+		break;
+
+	case t16::wide:
+		f.length = 4;
+
+		if (size - pos < 4)
+			f.error |= error_eof;
+		else
+			decode_thumb_wide(hw1, fetch16(buffer, pos + 2), pos, f);
+		break;
+
+	default:
+		break;
 	}
-	else if ((bc & 0x0c000000) == 0x04000000)
+
+	// Inside an IT block the block's condition applies, then the block
+	// moves on by one instruction
+	if (it_state & 0xf)
+		f.cond = it_state >> 4;
+
+	if (is_it)
+		f.it_state = static_cast<uint8_t>(hw1);
+	else if (it_state & 0x7)
+		f.it_state = (it_state & 0xe0) | ((it_state << 1) & 0x1f);
+
+	return f;
+}
+
+} // namespace
+
+
+void Inst_ARM::internal_decode(const uint8_t* buffer, size_t size,
+                               CPU_state state)
+{
+	switch (state)
 	{
-		// Load/Store Byte/Word
-	}
-	else if ((bc & 0x0e000000) == 0x08000000)
+	case CPU_state::arm:
 	{
-		// Load/Store Multiple
+		if (pos % 4 != 0)
+			signal_error(Error::alignment);
+
+		length = 4;
+		uint32_t bc = fetch(buffer, size, 4);
+
+		if (!has_error(Error::eof))
+			decode_as_arm(bc);
+		break;
 	}
-	else if ((bc & 0x0e000090) == 0x00000090)
-	{
-		// Halfword transfer: Immediate offset (v4 only)
+
+	case CPU_state::thumb:
+		decode_as_thumb(buffer, size);
+		break;
+
+	default:
+		signal_error(Error::cpu_state);
+		break;
 	}
-	else if ((bc & 0x0e000f90) == 0x00000090)
+}
+
+void Inst_ARM::decode_as_arm(uint32_t bc)
+{
+	if ((bc >> 28) == 0xf)
 	{
-		// Halfword transfer: Immediate offset (v4 only)
+		decode_unconditional(bc);
+		return;
 	}
-	else if ((bc & 0x0e000000) == 0x0a000000)
+
+	cond = static_cast<Exec_cond>(bc >> 28);
+
+	const uint32_t op = (bc >> 21) & 0xf;
+	const bool load = (bc & 0x00100000) != 0;
+
+	switch (a32::table[a32::row[(bc >> 20) & 0xff]][(bc >> 4) & 0xf])
 	{
-		// Branch
+	case a32::dp_reg:
+	case a32::dp_rsr:
+	case a32::dp_imm:
+		if (dp_writes_rd >> op & 1)
+		{
+			rd = reg(bc, 12);
+			is_branch = rd == 15;
+		}
+
+		if (dp_reads_rn >> op & 1)
+			rn = reg(bc, 16);
+
+		if (bc & 0x02000000)
+		{
+			has_imm = true;
+			imm = rotated_imm(bc);
+		}
+		else
+		{
+			rm = reg(bc, 0);
+
+			if (bc & 0x10)
+				rs = reg(bc, 8);
+		}
+		break;
+
+	case a32::mov_imm16:
+		rd = reg(bc, 12);
+		has_imm = true;
+		imm = ((bc >> 4) & 0xf000) | (bc & 0x0fff);
+		break;
+
+	case a32::msr_imm:
+		has_imm = true;
+		imm = rotated_imm(bc);
+		break;
+
+	case a32::mul:
+		rd = reg(bc, 16);
+		rs = reg(bc, 8);
+		rm = reg(bc, 0);
+
+		// All but MUL, SMULxy and SMULWy accumulate
+		if ((bc & 0x0fe000f0) != 0x00000090 &&
+		    (bc & 0x0ff00090) != 0x01600080 &&
+		    (bc & 0x0ff000b0) != 0x012000a0)
+		{
+			rn = reg(bc, 12);
+		}
+		break;
+
+	case a32::sync:
+		rn = reg(bc, 16);
+		rd = reg(bc, 12);
+
+		// LDREX has no source register
+		if ((bc & 0x00900000) != 0x00900000)
+			rm = reg(bc, 0);
+		break;
+
+	case a32::extra_ls:
+		rn = reg(bc, 16);
+		rd = reg(bc, 12);
+
+		if (bc & 0x00400000)
+		{
+			has_imm = true;
+			imm = signed_offset(bc, ((bc >> 4) & 0xf0) | (bc & 0xf));
+		}
+		else
+		{
+			rm = reg(bc, 0);
+		}
+		break;
+
+	case a32::misc:
+		switch (((bc >> 4) & 7) << 2 | (op & 3))
+		{
+		case 0 << 2 | 0: // MRS
+		case 0 << 2 | 2:
+			rd = reg(bc, 12);
+			break;
+
+		case 0 << 2 | 1: // MSR
+		case 0 << 2 | 3:
+			rm = reg(bc, 0);
+			break;
+
+		case 1 << 2 | 1: // BX
+		case 2 << 2 | 1: // BXJ
+			is_branch = true;
+			rm = reg(bc, 0);
+			break;
+
+		case 3 << 2 | 1: // BLX
+			is_branch = true;
+			has_link = true;
+			rm = reg(bc, 0);
+			break;
+
+		case 1 << 2 | 3: // CLZ
+			rd = reg(bc, 12);
+			rm = reg(bc, 0);
+			break;
+
+		case 5 << 2 | 0: // QADD, QSUB, QDADD, QDSUB
+		case 5 << 2 | 1:
+		case 5 << 2 | 2:
+		case 5 << 2 | 3:
+			rd = reg(bc, 12);
+			rn = reg(bc, 16);
+			rm = reg(bc, 0);
+			break;
+
+		case 6 << 2 | 3: // ERET
+			is_branch = true;
+			break;
+
+		case 7 << 2 | 1: // BKPT
+		case 7 << 2 | 2: // HVC
+			has_imm = true;
+			imm = ((bc >> 4) & 0xfff0) | (bc & 0xf);
+			break;
+
+		case 7 << 2 | 3: // SMC
+			has_imm = true;
+			imm = bc & 0xf;
+			break;
+
+		default:
+			signal_error(Error::opcode);
+			break;
+		}
+		break;
+
+	case a32::ls_imm:
+	case a32::ls_reg:
+		rn = reg(bc, 16);
+		rd = reg(bc, 12);
+		is_branch = load && rd == 15;
+
+		if (bc & 0x02000000)
+		{
+			rm = reg(bc, 0);
+		}
+		else
+		{
+			has_imm = true;
+			imm = signed_offset(bc, bc & 0xfff);
+		}
+		break;
+
+	case a32::media:
+		decode_media(bc);
+		break;
+
+	case a32::ls_multi:
+		rn = reg(bc, 16);
+		reg_list = static_cast<uint16_t>(bc);
+		is_branch = load && (bc & 0x8000);
+		break;
+
+	case a32::branch_link:
+		has_link = true;
+		// fall through
+
+	case a32::branch:
+		is_branch = true;
+		has_rel = true;
+		rel = branch_rel(bc);
+		break;
+
+	case a32::coproc:
+		decode_coproc(bc);
+		break;
+
+	case a32::svc:
+		is_swi = true;
+		swi_data = static_cast<int32_t>(bc & 0x00ffffff);
+		break;
+
+	default:
+		signal_error(Error::opcode);
+		break;
 	}
-	else if ((bc & 0x0ffffff0) == 0x012fff10)
+}
+
+void Inst_ARM::decode_media(uint32_t bc)
+{
+	switch ((bc >> 23) & 3)
 	{
-		// Branch Exchange
+	case 0: // parallel add and subtract
+		rn = reg(bc, 16);
+		rd = reg(bc, 12);
+		rm = reg(bc, 0);
+		break;
+
+	case 1: // pack, unpack, saturate, reverse
+		rd = reg(bc, 12);
+		rm = reg(bc, 0);
+
+		if ((bc & 0x00200030) == 0x00200010) // SSAT, USAT
+		{
+			has_imm = true;
+			imm = (bc >> 16) & 0x1f;
+		}
+		else if ((bc & 0x003000f0) == 0x00200030) // SSAT16, USAT16
+		{
+			has_imm = true;
+			imm = (bc >> 16) & 0xf;
+		}
+		else if (reg(bc, 16) != 15)
+		{
+			rn = reg(bc, 16);
+		}
+		break;
+
+	case 2: // signed multiplies
+		rd = reg(bc, 16);
+		rs = reg(bc, 8);
+		rm = reg(bc, 0);
+
+		if (reg(bc, 12) != 15)
+			rn = reg(bc, 12);
+		break;
+
+	case 3:
+		if ((bc & 0x00700000) == 0) // USAD8, USADA8
+		{
+			rd = reg(bc, 16);
+			rs = reg(bc, 8);
+			rm = reg(bc, 0);
+
+			if (reg(bc, 12) != 15)
+				rn = reg(bc, 12);
+		}
+		else // SBFX, UBFX, BFI, BFC, lsb in imm
+		{
+			rd = reg(bc, 12);
+			has_imm = true;
+			imm = (bc >> 7) & 0x1f;
+
+			if (reg(bc, 0) != 15)
+				rn = reg(bc, 0);
+		}
+		break;
 	}
-	else if ((bc & 0x0e000000) == 0x0c000000)
+}
+
+void Inst_ARM::decode_coproc(uint32_t bc)
+{
+	if ((bc & 0x0fe00000) == 0x0c400000) // MCRR, MRRC
 	{
-		// Coprocessor data transfer
+		rd = reg(bc, 12);
+		rn = reg(bc, 16);
 	}
-	else if ((bc & 0x0f000010) == 0x0e000000)
+	else if ((bc & 0x0e000000) == 0x0c000000) // LDC, STC
 	{
-		// Coprocessor data operation
+		rn = reg(bc, 16);
+		has_imm = true;
+		imm = signed_offset(bc, (bc & 0xff) << 2);
 	}
-	else if ((bc & 0x0f000010) == 0x0e000010)
+	else if (bc & 0x00000010) // MCR, MRC
 	{
-		// Coprocessor data register transfer
+		rd = reg(bc, 12);
 	}
-	else if ((bc & 0x0f000000) == 0x0f000000)
+}
+
+// Instructions with condition 1111 run unconditionally and keep cond as al
+void Inst_ARM::decode_unconditional(uint32_t bc)
+{
+	switch ((bc >> 25) & 7)
 	{
-		// Software interrupt
+	case 2: // PLD, PLI
+	case 3:
+		rn = reg(bc, 16);
+		break;
+
+	case 4: // SRS, RFE
+		rn = reg(bc, 16);
+		is_branch = (bc & 0x00500000) == 0x00100000;
+		break;
+
+	case 5: // BLX with an immediate, switches to Thumb
+		is_branch = true;
+		has_link = true;
+		has_rel = true;
+		rel = branch_rel(bc) | ((bc >> 23) & 2);
+		break;
+
+	case 6: // LDC2, STC2, MCRR2, MRRC2
+	case 7: // CDP2, MCR2, MRC2
+		decode_coproc(bc);
+		break;
+
+	default: // CPS, SETEND, CLREX, barriers
+		break;
 	}
-	else
+}
+
+constexpr std::uint8_t Inst_ARM::no_reg;
+
+void Inst_ARM::decode_as_thumb(const uint8_t* buffer, size_t size)
+{
+	const Thumb_flow f = decode_thumb(buffer, size, pos, it_state);
+
+	length    = f.length;
+	cond      = static_cast<Exec_cond>(f.cond);
+	it_state  = f.it_state;
+	is_branch = f.is_branch;
+	has_link  = f.has_link;
+	has_rel   = f.has_rel;
+	rel       = f.rel;
+	is_swi    = f.is_swi;
+	swi_data  = f.swi_data;
+
+	error_flags |= f.error;
+	pos += f.length;
+}
+
+size_t ssde::thumb_decode_range(const uint8_t* buffer, size_t size,
+                                size_t start, size_t end,
+                                const Range_thumb& out, uint8_t& it_state)
+{
+	if (end > size)
+		end = size;
+
+	size_t pos = start;
+	size_t count = 0;
+
+	while (pos < end && count < out.capacity)
 	{
-		signal_error(Error::opcode);
+		const Thumb_flow f = decode_thumb(buffer, size, pos, it_state);
+
+		out.offset[count]    = pos;
+		out.length[count]    = f.length;
+		out.target[count]    = static_cast<int64_t>(pos) + f.rel;
+		out.has_rel[count]   = f.has_rel;
+		out.is_branch[count] = static_cast<uint8_t>(f.is_branch |
+		                                            f.has_link << 1);
+		out.cond[count]      = f.cond;
+		out.error[count]     = f.error;
+
+		it_state = f.it_state;
+		pos += f.length;
+		++count;
 	}
-}
 
-// void Inst_ARM::decode_as_thumb(const std::vector<uint8_t>& buffer)
-// {
-// }
\ No newline at end of file
+	return count;
+}
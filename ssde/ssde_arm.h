@@ -76,12 +76,24 @@ public:
 	{
 	}
 
-	Inst_ARM(const std::vector<std::uint8_t>& in_buffer,
-	         std::size_t in_pos = 0,
-	         CPU_state   in_state = CPU_state::arm) :
+	// it_state is the IT state left by the previous instruction, which is
+	// only used in Thumb state.
+	Inst_ARM(const std::uint8_t* buffer, std::size_t size,
+	         std::size_t  in_pos = 0,
+	         CPU_state    in_state = CPU_state::arm,
+	         std::uint8_t in_it_state = 0) :
+		it_state(in_it_state),
 		pos(in_pos)
 	{
-		internal_decode(in_buffer, in_state);
+		internal_decode(buffer, size, in_state);
+	}
+
+	Inst_ARM(const std::vector<std::uint8_t>& buffer,
+	         std::size_t  in_pos = 0,
+	         CPU_state    in_state = CPU_state::arm,
+	         std::uint8_t in_it_state = 0) :
+		Inst_ARM(buffer.data(), buffer.size(), in_pos, in_state, in_it_state)
+	{
 	}
 
 	bool has_error(Error signal) const
@@ -97,26 +109,60 @@ public:
 
 	std::int32_t length = 0;
 
-	// Specifies condition required to execute the instruction
+	// Specifies condition required to execute the instruction. In Thumb
+	// state, that of the IT block the instruction is in, or that of B<c>.
 	Exec_cond cond = Exec_cond::al;
 
+	// Thumb IT state (ITSTATE) after the instruction, 0 outside of IT
+	// blocks. Pass it on to the next instruction when sweeping.
+	std::uint8_t it_state = 0;
+
+	// Set for anything that writes PC: B, BL, BLX, BX, as well as data
+	// processing, loads and LDM with PC as destination. Only B, BL and BLX
+	// with an immediate have a known target (has_rel).
 	bool    is_branch = false;
 	bool    has_link = false;
+	bool    has_rel = false;
 	// abs = pos + rel
 	std::int32_t rel = 0;
 
 	bool is_swi = false;
 	std::int32_t swi_data = 0;
 
+	// Operands are only filled in for A32.
+	//
+	// Register operands, no_reg where the instruction has none. rd is the
+	// destination (or the register transferred by a load or store), rn the
+	// first operand or base, rm the second operand or offset and rs the
+	// register holding a shift amount or multiplier. Multiplies keep their
+	// accumulator (or RdLo) in rn.
+	static constexpr std::uint8_t no_reg = 0xff;
+
+	std::uint8_t rd = no_reg;
+	std::uint8_t rn = no_reg;
+	std::uint8_t rm = no_reg;
+	std::uint8_t rs = no_reg;
+
+	// Registers transferred by LDM, STM, PUSH and POP, bit n for Rn
+	std::uint16_t reg_list = 0;
+
+	// Immediate operand: the rotated constant of data processing, the signed
+	// offset of loads and stores, the 16 bit constant of MOVW, MOVT, BKPT
+	bool has_imm = false;
+	std::uint32_t imm = 0;
+
 private:
-	void internal_decode(const std::vector<std::uint8_t>&, CPU_state);
+	void internal_decode(const std::uint8_t*, std::size_t, CPU_state);
 	void decode_as_arm(std::uint32_t);
-	// void decode_as_thumb(uint32_t);
+	void decode_media(std::uint32_t);
+	void decode_coproc(std::uint32_t);
+	void decode_unconditional(std::uint32_t);
+	void decode_as_thumb(const std::uint8_t*, std::size_t);
 
-	std::uint32_t fetch(const std::vector<std::uint8_t>& buffer,
+	std::uint32_t fetch(const std::uint8_t* buffer, std::size_t size,
 	                    std::size_t amount)
 	{
-		if ((pos + amount) < buffer.size())
+		if (pos <= size && amount <= size - pos)
 		{
 			std::uint32_t result = 0;
 
@@ -141,6 +187,31 @@ private:
 	std::uint8_t error_flags = 0;
 };
 
+
+// Struct-of-arrays output of thumb_decode_range, in the manner of Range_x86.
+// Arrays are owned by the caller and must have room for capacity entries.
+struct Range_thumb
+{
+	std::size_t*  offset    = nullptr; // where instruction starts
+	std::uint8_t* length    = nullptr; // 2 or 4
+	std::int64_t* target    = nullptr; // offset + rel, valid if has_rel is set
+	std::uint8_t* has_rel   = nullptr;
+	std::uint8_t* is_branch = nullptr; // bit 0 branch, bit 1 link
+	std::uint8_t* cond      = nullptr; // Inst_ARM::Exec_cond
+	std::uint8_t* error     = nullptr; // Inst_ARM::Error flags
+	std::size_t   capacity  = 0;
+};
+
+// Linear sweep over [start, end) of Thumb code, same as decoding Inst_ARMs
+// one after another, but each instruction is read once, with no operands
+// filled in. it_state is the IT state to start with and is left at the one
+// after the last instruction written, so a sweep can go on where it stopped.
+// Returns how many instructions were written.
+std::size_t thumb_decode_range(const std::uint8_t* buffer, std::size_t size,
+                               std::size_t start, std::size_t end,
+                               const Range_thumb& out,
+                               std::uint8_t& it_state);
+
 } // namespace ssde
 
 #endif // SSDE_ARM
\ No newline at end of file
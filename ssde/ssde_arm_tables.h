@@ -0,0 +1,196 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_ARM_TABLES_H
+#define SSDE_ARM_TABLES_H
+
+#include <cstdint>
+
+
+// Class tables of the A32, Thumb and A64 decoders. An A32 instruction is
+// classified by looking up bits 27..20 in a32::row and then bits 7..4 in the
+// row found, which sorts out the groups that share bits 27..20 (multiplies,
+// extra loads and stores, miscellaneous and media instructions) without
+// testing a single bit. A Thumb instruction is classified by the top 6 bits
+// of its first halfword, an A64 one by its top byte.
+
+namespace ssde
+{
+namespace detail
+{
+
+namespace a32
+{
+
+enum Class : std::uint8_t
+{
+	dp_reg,    // data processing, register shifted by an immediate
+	dp_rsr,    // data processing, register shifted by a register
+	dp_imm,    // data processing, rotated immediate
+	mov_imm16, // MOVW, MOVT
+	msr_imm,   // MSR with an immediate, hints
+	mul,       // multiply, multiply long, halfword multiply
+	sync,      // SWP, LDREX, STREX
+	extra_ls,  // LDRH, STRH, LDRSB, LDRSH, LDRD, STRD
+	misc,      // MRS, MSR, BX, BXJ, BLX, CLZ, saturating add, BKPT, SMC
+	ls_imm,    // LDR, STR, LDRB, STRB with an immediate offset
+	ls_reg,    // LDR, STR, LDRB, STRB with a register offset
+	media,     // parallel add, pack, saturate, reverse, signed multiply
+	ls_multi,  // LDM, STM
+	branch,    // B
+	branch_link, // BL
+	coproc,    // coprocessor transfers and data operations
+	svc,       // SVC (SWI)
+	undefined, // permanently undefined
+};
+
+enum Row : std::uint8_t
+{
+	r_dp,     // 00..0F
+	r_dp_sx,  // 11..1F, except misc ones
+	r_misc,   // 10, 12, 14, 16
+	r_imm,    // 2x, 3x
+	r_mov16,  // 30, 34
+	r_msr,    // 32, 36
+	r_ldi,    // 4x, 5x
+	r_ldr,    // 6x, 7x
+	r_udf,    // 7F
+	r_ldm,    // 8x, 9x
+	r_b,      // Ax
+	r_bl,     // Bx
+	r_cp,     // Cx..Ex
+	r_svc,    // Fx
+};
+
+// Row by bits 27..20
+static constexpr std::uint8_t row[256] =
+{
+	//x0  |   x1   |   x2   |   x3   |   x4   |   x5   |   x6   |   x7   |   x8   |   x9   |   xA   |   xB   |   xC   |   xD   |   xE   |   xF
+	 r_dp  , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , r_dp   , // 0x
+	 r_misc, r_dp_sx, r_misc , r_dp_sx, r_misc , r_dp_sx, r_misc , r_dp_sx, r_dp_sx, r_dp_sx, r_dp_sx, r_dp_sx, r_dp_sx, r_dp_sx, r_dp_sx, r_dp_sx, // 1x
+	 r_imm , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , // 2x
+	 r_mov16,r_imm  , r_msr  , r_imm  , r_mov16, r_imm  , r_msr  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , r_imm  , // 3x
+	 r_ldi , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , // 4x
+	 r_ldi , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , r_ldi  , // 5x
+	 r_ldr , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , // 6x
+	 r_ldr , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_ldr  , r_udf  , // 7x
+	 r_ldm , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , // 8x
+	 r_ldm , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , r_ldm  , // 9x
+	 r_b   , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , r_b    , // Ax
+	 r_bl  , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , r_bl   , // Bx
+	 r_cp  , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , // Cx
+	 r_cp  , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , // Dx
+	 r_cp  , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , r_cp   , // Ex
+	 r_svc , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , r_svc  , // Fx
+};
+
+// Class by row and bits 7..4
+static constexpr std::uint8_t table[14][16] =
+{
+	//x0     |   x1    |   x2    |   x3    |   x4    |   x5    |   x6    |   x7    |   x8    |   x9    |   xA    |   xB    |   xC    |   xD    |   xE    |   xF
+	{ dp_reg  , dp_rsr  , dp_reg  , dp_rsr  , dp_reg  , dp_rsr  , dp_reg  , dp_rsr  , dp_reg  , mul     , dp_reg  , extra_ls, dp_reg  , extra_ls, dp_reg  , extra_ls }, // r_dp
+	{ dp_reg  , dp_rsr  , dp_reg  , dp_rsr  , dp_reg  , dp_rsr  , dp_reg  , dp_rsr  , dp_reg  , sync    , dp_reg  , extra_ls, dp_reg  , extra_ls, dp_reg  , extra_ls }, // r_dp_sx
+	{ misc    , misc    , misc    , misc    , misc    , misc    , misc    , misc    , mul     , sync    , mul     , extra_ls, mul     , extra_ls, mul     , extra_ls }, // r_misc
+	{ dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm  , dp_imm   }, // r_imm
+	{mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16,mov_imm16}, // r_mov16
+	{ msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm , msr_imm  }, // r_msr
+	{ ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm  , ls_imm   }, // r_ldi
+	{ ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media    }, // r_ldr
+	{ ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , media   , ls_reg  , undefined}, // r_udf
+	{ ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi, ls_multi }, // r_ldm
+	{ branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch  , branch   }, // r_b
+	{branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link,branch_link}, // r_bl
+	{ coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc  , coproc   }, // r_cp
+	{ svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc     , svc      }, // r_svc
+};
+
+} // namespace a32
+
+namespace t16
+{
+
+enum Class : std::uint8_t
+{
+	plain,  // can't change flow
+	hi_reg, // ADD, MOV, CMP with high registers, BX, BLX
+	misc,   // CBZ, CBNZ, PUSH, POP, IT, hints, BKPT
+	cond,   // B<c>, UDF, SVC
+	branch, // B
+	wide,   // first halfword of a 32 bit instruction
+};
+
+// Class by bits 15..10 of the first halfword
+static constexpr std::uint8_t table[64] =
+{
+	//x0  |  x1   |  x2   |  x3   |  x4   |  x5   |  x6   |  x7   |  x8   |  x9   |  xA   |  xB   |  xC   |  xD   |  xE   |  xF
+	 plain, plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , // 0x
+	 plain, hi_reg, plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , // 1x
+	 plain, plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , plain , misc  , misc  , misc  , misc  , // 2x
+	 plain, plain , plain , plain , cond  , cond  , cond  , cond  , branch, branch, wide  , wide  , wide  , wide  , wide  , wide  , // 3x
+};
+
+} // namespace t16
+
+namespace a64
+{
+
+enum Class : std::uint8_t
+{
+	no,   // can't change flow or form an address
+	b,    // B
+	bl,   // BL
+	bc,   // B.cond, BC.cond
+	cb,   // CBZ, CBNZ
+	tb,   // TBZ, TBNZ
+	adr,  // ADR
+	adrp, // ADRP
+	exc,  // SVC, HVC, SMC, BRK, HLT, DCPS
+	br,   // BR, BLR, RET, ERET and their authenticated forms
+	udf,  // UDF if bits 23..16 are clear
+};
+
+// Class by bits 31..24
+static constexpr std::uint8_t table[256] =
+{
+	//x0 | x1 | x2 | x3 | x4 | x5 | x6 | x7 | x8 | x9 | xA | xB | xC | xD | xE | xF
+	 udf , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // 0x
+	 adr , no , no , no ,  b ,  b ,  b ,  b , no , no , no , no , no , no , no , no , // 1x
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // 2x
+	 adr , no , no , no , cb , cb , tb , tb , no , no , no , no , no , no , no , no , // 3x
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // 4x
+	 adr , no , no , no , bc , no , no , no , no , no , no , no , no , no , no , no , // 5x
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // 6x
+	 adr , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // 7x
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // 8x
+	 adrp, no , no , no , bl , bl , bl , bl , no , no , no , no , no , no , no , no , // 9x
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // Ax
+	 adrp, no , no , no , cb , cb , tb , tb , no , no , no , no , no , no , no , no , // Bx
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // Cx
+	 adrp, no , no , no , exc, no , br , br , no , no , no , no , no , no , no , no , // Dx
+	 no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // Ex
+	 adrp, no , no , no , no , no , no , no , no , no , no , no , no , no , no , no , // Fx
+};
+
+} // namespace a64
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_ARM_TABLES_H
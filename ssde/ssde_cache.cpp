@@ -0,0 +1,445 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Concurrent cache of decoded X64 instructions
+#include "ssde_cache.h"
+#include "ssde_x64.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+
+
+using ssde::Decode_cache_x64;
+using ssde::Inst_x64;
+using ssde::Inst_x64_packed;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uintptr_t;
+
+
+namespace
+{
+
+// Longest instruction, anything further back can't overlap a given byte
+const size_t max_length = 15;
+
+// Ranges longer than this are invalidated by scanning the shards instead of
+// looking up every offset
+const size_t max_lookups = 4096;
+
+const auto relaxed = std::memory_order_relaxed;
+
+// Counter of the calling thread
+std::atomic<size_t> next_thread{0};
+thread_local size_t thread_index = next_thread++;
+
+} // namespace
+
+
+Decode_cache_x64::Decode_cache_x64(size_t capacity)
+	: shards(new Shard[shard_count]), counters(new Counter[counter_count])
+{
+	// Tables are kept at most half full, so that probes stay short
+	size_t slots = 16;
+
+	while (slots < 2 * (capacity / shard_count + 1))
+		slots *= 2;
+
+	mask = slots - 1;
+	max_count = slots / 2;
+
+	for (size_t i = 0; i < shard_count; ++i)
+		shards[i].slots.reset(new Slot[slots]);
+}
+
+size_t Decode_cache_x64::hash(const uint8_t* buffer, size_t pos)
+{
+	uint64_t h = reinterpret_cast<uintptr_t>(buffer) ^
+	             static_cast<uint64_t>(pos) * 0x9e3779b97f4a7c15;
+
+	h ^= h >> 32;
+	h *= 0xd6e8feb86659fd93;
+	h ^= h >> 32;
+
+	return static_cast<size_t>(h);
+}
+
+Decode_cache_x64::Counter& Decode_cache_x64::counter() const
+{
+	return counters[thread_index % counter_count];
+}
+
+bool Decode_cache_x64::lookup(const Shard& shard, size_t h,
+                              const uint8_t* buffer, size_t size, size_t pos,
+                              Inst_x64_packed& inst) const
+{
+	const uintptr_t key = reinterpret_cast<uintptr_t>(buffer);
+
+	for (;;)
+	{
+		const uint32_t sequence = shard.sequence.load(std::memory_order_acquire);
+
+		bool found = false;
+		uint64_t words_read[words];
+
+		if ((sequence & 1) == 0)
+		{
+			// Linear probing, up to the first empty slot. The table is never
+			// full, but a torn read could make it look that way.
+			for (size_t i = h & mask, n = 0; n <= mask; i = (i + 1) & mask, ++n)
+			{
+				const Slot& slot = shard.slots[i];
+				const uintptr_t slot_buffer = slot.buffer.load(relaxed);
+
+				if (slot_buffer == 0)
+					break;
+
+				if (slot_buffer == key && slot.pos.load(relaxed) == pos &&
+				    slot.size.load(relaxed) == size)
+				{
+					for (size_t w = 0; w < words; ++w)
+						words_read[w] = slot.inst[w].load(relaxed);
+
+					found = true;
+					break;
+				}
+			}
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if ((sequence & 1) == 0 && shard.sequence.load(relaxed) == sequence)
+		{
+			if (found)
+				std::memcpy(&inst, words_read, sizeof(inst));
+
+			return found;
+		}
+	}
+}
+
+void Decode_cache_x64::begin_write(Shard& shard)
+{
+	shard.sequence.store(shard.sequence.load(relaxed) + 1, relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void Decode_cache_x64::end_write(Shard& shard)
+{
+	shard.sequence.store(shard.sequence.load(relaxed) + 1,
+	                     std::memory_order_release);
+}
+
+// Invalidations bump the generation of every shard they look at, so that a
+// decode that started before can tell not to insert
+void Decode_cache_x64::bump_generation(Shard& shard)
+{
+	shard.generation.store(shard.generation.load(relaxed) + 1,
+	                       std::memory_order_release);
+}
+
+void Decode_cache_x64::insert(Shard& shard, size_t h, const uint8_t* buffer,
+                              size_t size, size_t pos,
+                              const Inst_x64_packed& inst)
+{
+	const uintptr_t key = reinterpret_cast<uintptr_t>(buffer);
+
+	uint64_t words_written[words] = {};
+	std::memcpy(words_written, &inst, sizeof(inst));
+
+	begin_write(shard);
+
+	if (shard.count >= max_count)
+	{
+		for (size_t i = 0; i <= mask; ++i)
+			shard.slots[i].buffer.store(0, relaxed);
+
+		shard.count = 0;
+	}
+
+	size_t i = h & mask;
+
+	// Another thread may have inserted pos since the lookup
+	while (shard.slots[i].buffer.load(relaxed) != 0 &&
+	       !(shard.slots[i].buffer.load(relaxed) == key &&
+	         shard.slots[i].pos.load(relaxed) == pos &&
+	         shard.slots[i].size.load(relaxed) == size))
+	{
+		i = (i + 1) & mask;
+	}
+
+	Slot& slot = shard.slots[i];
+
+	if (slot.buffer.load(relaxed) == 0)
+		shard.count++;
+
+	slot.buffer.store(key, relaxed);
+	slot.size.store(size, relaxed);
+	slot.pos.store(pos, relaxed);
+
+	for (size_t w = 0; w < words; ++w)
+		slot.inst[w].store(words_written[w], relaxed);
+
+	end_write(shard);
+}
+
+// Empties slot i, moving later entries of the same probe sequence back so
+// that no lookup stops short of them
+void Decode_cache_x64::erase(Shard& shard, size_t i)
+{
+	for (size_t j = (i + 1) & mask; ; j = (j + 1) & mask)
+	{
+		Slot& next = shard.slots[j];
+		const uintptr_t buffer = next.buffer.load(relaxed);
+
+		if (buffer == 0)
+			break;
+
+		const size_t pos = next.pos.load(relaxed);
+		const size_t home = hash(reinterpret_cast<const uint8_t*>(buffer), pos) &
+		                    mask;
+
+		// Entry j may move to i if i lies on the way from its home to j
+		if (((j - home) & mask) >= ((j - i) & mask))
+		{
+			Slot& hole = shard.slots[i];
+
+			hole.buffer.store(buffer, relaxed);
+			hole.size.store(next.size.load(relaxed), relaxed);
+			hole.pos.store(pos, relaxed);
+
+			for (size_t w = 0; w < words; ++w)
+				hole.inst[w].store(next.inst[w].load(relaxed), relaxed);
+
+			i = j;
+		}
+	}
+
+	shard.slots[i].buffer.store(0, relaxed);
+	shard.count--;
+}
+
+Inst_x64_packed Decode_cache_x64::decode(const uint8_t* buffer, size_t size,
+                                         size_t pos)
+{
+	const size_t h = hash(buffer, pos);
+	Shard& shard = shards[(h >> 58) % shard_count];
+
+	Inst_x64_packed inst;
+
+	if (lookup(shard, h, buffer, size, pos, inst))
+	{
+		counter().hits.fetch_add(1, relaxed);
+		return inst;
+	}
+
+	counter().misses.fetch_add(1, relaxed);
+
+	// Decode without holding the lock. Two threads missing on the same
+	// instruction both decode it, which is harmless. If the shard saw an
+	// invalidation meanwhile, the bytes may have changed under the decode
+	// and it isn't kept.
+	const uint32_t generation =
+		shard.generation.load(std::memory_order_acquire);
+
+	inst = Inst_x64_packed{Inst_x64(buffer, size, pos)};
+
+	std::lock_guard<std::mutex> lock(shard.write);
+
+	if (shard.generation.load(relaxed) == generation)
+		insert(shard, h, buffer, size, pos, inst);
+
+	return inst;
+}
+
+bool Decode_cache_x64::find(const uint8_t* buffer, size_t size, size_t pos,
+                            Inst_x64_packed& inst) const
+{
+	const size_t h = hash(buffer, pos);
+
+	return lookup(shards[(h >> 58) % shard_count], h, buffer, size, pos,
+	              inst);
+}
+
+template <typename Drop>
+void Decode_cache_x64::drop_if(const uint8_t* buffer, Drop drop)
+{
+	const uintptr_t key = reinterpret_cast<uintptr_t>(buffer);
+
+	for (size_t s = 0; s < shard_count; ++s)
+	{
+		Shard& shard = shards[s];
+		std::lock_guard<std::mutex> lock(shard.write);
+
+		bump_generation(shard);
+		begin_write(shard);
+
+		// An erase may move a later entry into slot i, so i is checked
+		// again before moving on
+		for (size_t i = 0; i <= mask; )
+		{
+			const Slot& slot = shard.slots[i];
+
+			if (slot.buffer.load(relaxed) == key &&
+			    drop(slot.pos.load(relaxed), slot))
+			{
+				erase(shard, i);
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		end_write(shard);
+	}
+}
+
+void Decode_cache_x64::invalidate(const uint8_t* buffer, size_t begin,
+                                  size_t end)
+{
+	if (begin >= end)
+		return;
+
+	auto overlaps = [begin, end](size_t pos, const Slot& slot)
+	{
+		Inst_x64_packed inst;
+		uint64_t words_read[words];
+
+		for (size_t w = 0; w < words; ++w)
+			words_read[w] = slot.inst[w].load(relaxed);
+
+		std::memcpy(&inst, words_read, sizeof(inst));
+
+		return pos < end && pos + static_cast<size_t>(inst.length()) > begin;
+	};
+
+	if (end - begin > max_lookups)
+	{
+		drop_if(buffer, overlaps);
+		return;
+	}
+
+	const uintptr_t key = reinterpret_cast<uintptr_t>(buffer);
+
+	// Instructions starting up to max_length - 1 bytes before begin may
+	// reach into the range
+	const size_t first = begin >= max_length - 1 ? begin - (max_length - 1) : 0;
+
+	for (size_t pos = first; pos < end; ++pos)
+	{
+		const size_t h = hash(buffer, pos);
+		Shard& shard = shards[(h >> 58) % shard_count];
+
+		std::lock_guard<std::mutex> lock(shard.write);
+
+		bump_generation(shard);
+
+		// pos may be cached once per size it was decoded with. As in drop_if
+		// an erase may move a later entry into slot i.
+		bool writing = false;
+
+		for (size_t i = h & mask; shard.slots[i].buffer.load(relaxed) != 0; )
+		{
+			const Slot& slot = shard.slots[i];
+
+			if (slot.buffer.load(relaxed) == key &&
+			    slot.pos.load(relaxed) == pos && overlaps(pos, slot))
+			{
+				if (!writing)
+					begin_write(shard);
+
+				writing = true;
+				erase(shard, i);
+			}
+			else
+			{
+				i = (i + 1) & mask;
+			}
+		}
+
+		if (writing)
+			end_write(shard);
+	}
+}
+
+void Decode_cache_x64::invalidate(const uint8_t* buffer)
+{
+	drop_if(buffer, [](size_t, const Slot&)
+	{
+		return true;
+	});
+}
+
+void Decode_cache_x64::clear()
+{
+	for (size_t s = 0; s < shard_count; ++s)
+	{
+		Shard& shard = shards[s];
+		std::lock_guard<std::mutex> lock(shard.write);
+
+		bump_generation(shard);
+		begin_write(shard);
+
+		for (size_t i = 0; i <= mask; ++i)
+			shard.slots[i].buffer.store(0, relaxed);
+
+		shard.count = 0;
+
+		end_write(shard);
+	}
+}
+
+Decode_cache_x64::Stats Decode_cache_x64::stats() const
+{
+	Stats stats;
+
+	for (size_t i = 0; i < counter_count; ++i)
+	{
+		stats.hits   += counters[i].hits.load(relaxed);
+		stats.misses += counters[i].misses.load(relaxed);
+	}
+
+	for (size_t s = 0; s < shard_count; ++s)
+	{
+		std::lock_guard<std::mutex> lock(shards[s].write);
+		stats.entries += shards[s].count;
+	}
+
+	return stats;
+}
+
+void Decode_cache_x64::reset_stats()
+{
+	for (size_t i = 0; i < counter_count; ++i)
+	{
+		counters[i].hits.store(0, relaxed);
+		counters[i].misses.store(0, relaxed);
+	}
+}
+
+constexpr size_t Decode_cache_x64::shard_count;
+constexpr size_t Decode_cache_x64::counter_count;
+constexpr size_t Decode_cache_x64::words;
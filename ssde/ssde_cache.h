@@ -0,0 +1,162 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_CACHE_H
+#define SSDE_CACHE_H
+
+#include "ssde_x64.h"
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+
+namespace ssde
+{
+
+// Cache of decoded instructions for code that is decoded over and over, such
+// as the hot paths of an emulator. Instructions are kept as Inst_x64_packed,
+// keyed by the buffer they were decoded from, its size and their offset in
+// it. The size is part of the key as an instruction cut short by the end of
+// the buffer decodes differently than in a longer one.
+//
+// The cache is split into shards, each an open addressing table of fixed
+// size. Lookups take no lock and write no shared memory: a reader retries
+// if the shard's sequence number shows that a writer got in its way.
+// Writers of a shard are serialized by a mutex. When a shard fills up it is
+// emptied.
+//
+// The cache can't tell when code changes. Whoever writes to a buffer must
+// call invalidate() for the bytes written.
+class Decode_cache_x64
+{
+public:
+	struct Stats
+	{
+		std::uint64_t hits    = 0;
+		std::uint64_t misses  = 0;
+		std::size_t   entries = 0;
+	};
+
+	// capacity is the number of instructions kept, at most. Memory taken is
+	// about 100 bytes per instruction.
+	explicit Decode_cache_x64(std::size_t capacity = 1 << 16);
+
+	Decode_cache_x64(const Decode_cache_x64&) = delete;
+	Decode_cache_x64& operator=(const Decode_cache_x64&) = delete;
+
+	// Instruction at pos, decoded now if it isn't in the cache. buffer must
+	// not be null.
+	Inst_x64_packed decode(const std::uint8_t* buffer, std::size_t size,
+	                       std::size_t pos);
+
+	// Looks pos up without decoding, returns whether it was found. Doesn't
+	// count as a hit or miss.
+	bool find(const std::uint8_t* buffer, std::size_t size, std::size_t pos,
+	          Inst_x64_packed& inst) const;
+
+	// Drops every instruction of buffer that overlaps [begin, end), whatever
+	// the size it was decoded with. Decodes racing with this don't make it
+	// into the cache.
+	void invalidate(const std::uint8_t* buffer, std::size_t begin,
+	                std::size_t end);
+
+	// Drops every instruction of buffer
+	void invalidate(const std::uint8_t* buffer);
+
+	void clear();
+
+	// Counters are summed up without stopping other threads, so they may be
+	// off by the lookups in flight
+	Stats stats() const;
+
+	void reset_stats();
+
+private:
+	static constexpr std::size_t shard_count = 64;
+	static constexpr std::size_t counter_count = 64;
+	static constexpr std::size_t words =
+		(sizeof(Inst_x64_packed) + sizeof(std::uint64_t) - 1) /
+		sizeof(std::uint64_t);
+
+	// Empty if buffer is 0. All fields are atomics so that readers may race
+	// with writers, the sequence number tells them when they did.
+	struct Slot
+	{
+		std::atomic<std::uintptr_t> buffer{0};
+		std::atomic<std::size_t>    size{0};
+		std::atomic<std::size_t>    pos{0};
+		std::atomic<std::uint64_t>  inst[words];
+	};
+
+	struct Shard
+	{
+		std::atomic<std::uint32_t> sequence{0}; // odd while being written
+		std::atomic<std::uint32_t> generation{0}; // bumped by invalidations
+		std::mutex write;
+
+		std::unique_ptr<Slot[]> slots;
+		std::size_t count = 0;
+
+		// Keeps neighbouring shards off each other's cache lines
+		char padding[64];
+	};
+
+	// Hits and misses, spread over threads so that they don't fight over
+	// one cache line
+	struct Counter
+	{
+		std::atomic<std::uint64_t> hits{0};
+		std::atomic<std::uint64_t> misses{0};
+
+		char padding[64 - 2 * sizeof(std::uint64_t)];
+	};
+
+	static std::size_t hash(const std::uint8_t* buffer, std::size_t pos);
+
+	Counter& counter() const;
+
+	bool lookup(const Shard& shard, std::size_t h, const std::uint8_t* buffer,
+	            std::size_t size, std::size_t pos,
+	            Inst_x64_packed& inst) const;
+
+	// These expect the shard's write mutex to be held
+	void insert(Shard& shard, std::size_t h, const std::uint8_t* buffer,
+	            std::size_t size, std::size_t pos,
+	            const Inst_x64_packed& inst);
+	void erase(Shard& shard, std::size_t i);
+	void begin_write(Shard& shard);
+	void end_write(Shard& shard);
+	void bump_generation(Shard& shard);
+
+	template <typename Drop>
+	void drop_if(const std::uint8_t* buffer, Drop drop);
+
+	std::size_t mask;      // slots per shard - 1
+	std::size_t max_count; // entries per shard before it is emptied
+
+	std::unique_ptr<Shard[]>   shards;
+	std::unique_ptr<Counter[]> counters;
+};
+
+} // namespace ssde
+
+#endif // SSDE_CACHE_H
@@ -0,0 +1,464 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Parallel function discovery for X86 and X64
+#include "ssde_callgraph.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include "ssde_x86_length.h"
+#include "ssde_x86_flow.h"
+#include "ssde_parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using ssde::Call_graph;
+using ssde::Flow;
+using ssde::Mode_x86;
+using ssde::Mode_x64;
+using ssde::Length_x86;
+using ssde::Length_x64;
+using ssde::detail::Prefix_run;
+using ssde::detail::scan_prefixes_scalar;
+using ssde::detail::decode_length;
+using ssde::detail::classify;
+using ssde::detail::ends_block;
+using ssde::detail::default_threads;
+using ssde::detail::parallel_for;
+using std::vector;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::int64_t;
+
+
+namespace
+{
+
+const size_t page_bits = 4096;
+
+// Bit per byte of the buffer, shared between threads
+class Shared_set
+{
+public:
+	explicit Shared_set(size_t size)
+		: bits(new std::atomic<uint64_t>[(size + 63) / 64]())
+	{
+	}
+
+	// Sets pos, returns whether it was set already
+	bool test_and_set(size_t pos)
+	{
+		std::atomic<uint64_t>& word = bits[pos / 64];
+		uint64_t bit = uint64_t(1) << (pos % 64);
+
+		// Most targets are called many times, check before writing
+		if (word.load(std::memory_order_relaxed) & bit)
+			return true;
+
+		return word.fetch_or(bit) & bit;
+	}
+
+private:
+	std::unique_ptr<std::atomic<uint64_t>[]> bits;
+};
+
+// Bit per byte of the buffer, with 4 KB pages taken on first use and given
+// back by clear(), so that clearing costs as much as the function walked
+class Local_set
+{
+public:
+	explicit Local_set(size_t size)
+		: pages((size + page_bits - 1) / page_bits, nullptr)
+	{
+	}
+
+	bool test(size_t pos) const
+	{
+		const uint64_t* page = pages[pos / page_bits];
+		size_t bit = pos % page_bits;
+
+		return page && (page[bit / 64] >> (bit % 64) & 1);
+	}
+
+	void set(size_t pos)
+	{
+		uint64_t*& page = pages[pos / page_bits];
+		size_t bit = pos % page_bits;
+
+		if (!page)
+		{
+			if (spare.empty())
+			{
+				storage.emplace_back(new uint64_t[page_bits / 64]());
+				spare.push_back(storage.back().get());
+			}
+
+			page = spare.back();
+			spare.pop_back();
+			touched.push_back(pos / page_bits);
+		}
+
+		page[bit / 64] |= uint64_t(1) << (bit % 64);
+	}
+
+	void clear()
+	{
+		for (size_t i : touched)
+		{
+			std::memset(pages[i], 0, page_bits / 8);
+			spare.push_back(pages[i]);
+			pages[i] = nullptr;
+		}
+
+		touched.clear();
+	}
+
+private:
+	vector<uint64_t*> pages;
+	vector<size_t> touched;
+	vector<uint64_t*> spare;
+	vector<std::unique_ptr<uint64_t[]>> storage;
+};
+
+// Function starts waiting to be walked. The owner works at the back, where
+// the functions it found last are, thieves take from the front.
+class Work_queue
+{
+public:
+	void push(size_t pos)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(pos);
+	}
+
+	bool pop(size_t& pos)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (tasks.empty())
+			return false;
+
+		pos = tasks.back();
+		tasks.pop_back();
+		return true;
+	}
+
+	bool steal(size_t& pos)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (tasks.empty())
+			return false;
+
+		pos = tasks.front();
+		tasks.pop_front();
+		return true;
+	}
+
+private:
+	std::mutex mutex;
+	std::deque<size_t> tasks;
+};
+
+struct Function
+{
+	size_t start;
+	uint32_t inst_count;
+	// Direct call targets are (*calls)[first_call] to (*calls)[last_call - 1]
+	const vector<size_t>* calls;
+	size_t first_call;
+	size_t last_call;
+};
+
+struct Worker
+{
+	explicit Worker(size_t size)
+		: local(size)
+	{
+	}
+
+	Work_queue queue;
+	Local_set local;
+	vector<size_t> stack;
+
+	vector<Function> functions;
+	vector<size_t> calls;
+};
+
+template <typename Mode, typename Length>
+class Discovery
+{
+public:
+	Discovery(const uint8_t* buffer, size_t size, unsigned threads)
+		: buffer(buffer), size(size), found(size)
+	{
+		for (unsigned i = 0; i < threads; ++i)
+			workers.emplace_back(new Worker(size));
+	}
+
+	// Queues pos on worker w unless it was found before
+	void add(size_t w, size_t pos)
+	{
+		if (found.test_and_set(pos))
+			return;
+
+		pending++;
+		workers[w]->queue.push(pos);
+	}
+
+	void run(size_t w)
+	{
+		size_t pos;
+
+		for (;;)
+		{
+			if (workers[w]->queue.pop(pos) || steal(w, pos))
+			{
+				walk(w, pos);
+				pending--;
+			}
+			else if (pending == 0)
+			{
+				return;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	Call_graph graph() const;
+
+private:
+	bool steal(size_t w, size_t& pos)
+	{
+		for (size_t i = 1; i < workers.size(); ++i)
+		{
+			if (workers[(w + i) % workers.size()]->queue.steal(pos))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Walks the function at start, queueing the functions it calls
+	void walk(size_t w, size_t start)
+	{
+		Worker& worker = *workers[w];
+
+		Function function;
+		function.start = start;
+		function.inst_count = 0;
+		function.calls = &worker.calls;
+		function.first_call = worker.calls.size();
+
+		worker.stack.clear();
+		worker.stack.push_back(start);
+
+		while (!worker.stack.empty())
+		{
+			size_t pos = worker.stack.back();
+			worker.stack.pop_back();
+
+			while (pos < size && !worker.local.test(pos))
+			{
+				worker.local.set(pos);
+
+				Prefix_run run = scan_prefixes_scalar<Mode>(buffer, size, pos);
+				Length len = decode_length<Mode, Length>(buffer, size, pos, run);
+				Flow flow = len.has_error() ? Flow::stop :
+				            classify(buffer, size, pos + run.length);
+
+				int64_t target = static_cast<int64_t>(pos) + len.rel;
+
+				function.inst_count++;
+				pos += len.length;
+
+				if (len.has_rel && target >= 0 &&
+				    static_cast<uint64_t>(target) < size)
+				{
+					if (flow == Flow::call)
+					{
+						worker.calls.push_back(static_cast<size_t>(target));
+						add(w, static_cast<size_t>(target));
+					}
+					else
+					{
+						worker.stack.push_back(static_cast<size_t>(target));
+					}
+				}
+
+				if (ends_block(flow) && flow != Flow::branch)
+					break;
+			}
+		}
+
+		worker.local.clear();
+
+		function.last_call = worker.calls.size();
+		worker.functions.push_back(function);
+	}
+
+	const uint8_t* buffer;
+	size_t size;
+
+	Shared_set found;
+	std::atomic<size_t> pending{0};
+	vector<std::unique_ptr<Worker>> workers;
+};
+
+template <typename Mode, typename Length>
+Call_graph Discovery<Mode, Length>::graph() const
+{
+	Call_graph graph;
+
+	vector<const Function*> functions;
+
+	for (const auto& worker : workers)
+	{
+		for (const Function& function : worker->functions)
+			functions.push_back(&function);
+	}
+
+	std::sort(functions.begin(), functions.end(),
+	          [](const Function* a, const Function* b)
+	{
+		return a->start < b->start;
+	});
+
+	const size_t count = functions.size();
+
+	graph.start.resize(count);
+	graph.inst_count.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		graph.start[i] = functions[i]->start;
+		graph.inst_count[i] = functions[i]->inst_count;
+	}
+
+	graph.callee_begin.resize(count + 1);
+	graph.caller_begin.assign(count + 1, 0);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Function& function = *functions[i];
+		const size_t first = graph.callee.size();
+
+		graph.callee_begin[i] = static_cast<uint32_t>(first);
+
+		// Every call target was made a function, so find always succeeds
+		for (size_t j = function.first_call; j < function.last_call; ++j)
+		{
+			size_t callee = graph.find((*function.calls)[j]);
+			graph.callee.push_back(static_cast<uint32_t>(callee));
+		}
+
+		std::sort(graph.callee.begin() + first, graph.callee.end());
+		graph.callee.erase(std::unique(graph.callee.begin() + first,
+		                               graph.callee.end()),
+		                   graph.callee.end());
+
+		for (size_t j = first; j < graph.callee.size(); ++j)
+			graph.caller_begin[graph.callee[j] + 1]++;
+	}
+
+	graph.callee_begin[count] = static_cast<uint32_t>(graph.callee.size());
+
+	for (size_t i = 0; i < count; ++i)
+		graph.caller_begin[i + 1] += graph.caller_begin[i];
+
+	graph.caller.resize(graph.caller_begin[count]);
+
+	// Callers come out in ascending order, since i only goes up
+	vector<uint32_t> fill(graph.caller_begin.begin(),
+	                      graph.caller_begin.end() - 1);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (size_t j = graph.callee_begin[i]; j < graph.callee_begin[i + 1]; ++j)
+			graph.caller[fill[graph.callee[j]]++] = static_cast<uint32_t>(i);
+	}
+
+	return graph;
+}
+
+template <typename Mode, typename Length>
+Call_graph discover_functions(const uint8_t* buffer, size_t size,
+                              const size_t* entries, size_t entry_count,
+                              unsigned threads)
+{
+	threads = default_threads(threads);
+
+	Discovery<Mode, Length> discovery(buffer, size, threads);
+
+	// Seeds are dealt out to all threads, so that they start right away
+	for (size_t i = 0; i < entry_count; ++i)
+	{
+		if (entries[i] < size)
+			discovery.add(i % threads, entries[i]);
+	}
+
+	parallel_for(threads, threads, [&](size_t w)
+	{
+		discovery.run(w);
+	});
+
+	return discovery.graph();
+}
+
+} // namespace
+
+
+size_t Call_graph::find(size_t pos) const
+{
+	auto it = std::lower_bound(start.begin(), start.end(), pos);
+
+	return it != start.end() && *it == pos ?
+	       static_cast<size_t>(it - start.begin()) : size();
+}
+
+Call_graph ssde::x86_discover_functions(const uint8_t* buffer, size_t size,
+                                        const size_t* entries,
+                                        size_t entry_count, unsigned threads)
+{
+	return discover_functions<Mode_x86, Length_x86>(buffer, size, entries,
+	                                                entry_count, threads);
+}
+
+Call_graph ssde::x64_discover_functions(const uint8_t* buffer, size_t size,
+                                        const size_t* entries,
+                                        size_t entry_count, unsigned threads)
+{
+	return discover_functions<Mode_x64, Length_x64>(buffer, size, entries,
+	                                                entry_count, threads);
+}
@@ -0,0 +1,81 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_CALLGRAPH_H
+#define SSDE_CALLGRAPH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Function discovery over a whole image. Functions are found by following
+// direct calls from a set of entry points, each one walked on its own by
+// recursive traversal, and linked into a call graph.
+
+namespace ssde
+{
+
+// Functions sorted by start. Callees of function i are
+// callee[callee_begin[i]] to callee[callee_begin[i + 1] - 1], callers are
+// laid out the same way. Both lists are sorted and hold no duplicates.
+struct Call_graph
+{
+	std::size_t size() const
+	{
+		return start.size();
+	}
+
+	// Index of the function starting at pos, size() if there is none
+	std::size_t find(std::size_t pos) const;
+
+
+	std::vector<std::size_t>   start;
+	std::vector<std::uint32_t> inst_count; // instructions reachable inside
+
+	std::vector<std::uint32_t> callee_begin;
+	std::vector<std::uint32_t> callee;
+
+	std::vector<std::uint32_t> caller_begin;
+	std::vector<std::uint32_t> caller;
+};
+
+// Discovers the functions of buffer reachable from entries, on threads
+// threads (0 picks one per core). Every direct call target inside the buffer
+// becomes a function; indirect calls and calls out of the buffer are not
+// followed. A function's instructions are those reachable from its start
+// through fall-through, branches and jumps, so code shared by several
+// functions is counted in each of them.
+//
+// Each newly found function is a task of its own. Threads keep their tasks
+// in their own queues and steal from the others when they run out.
+Call_graph x86_discover_functions(const std::uint8_t* buffer, std::size_t size,
+                                  const std::size_t* entries,
+                                  std::size_t entry_count,
+                                  unsigned threads = 0);
+
+Call_graph x64_discover_functions(const std::uint8_t* buffer, std::size_t size,
+                                  const std::size_t* entries,
+                                  std::size_t entry_count,
+                                  unsigned threads = 0);
+
+} // namespace ssde
+
+#endif // SSDE_CALLGRAPH_H
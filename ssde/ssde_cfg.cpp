@@ -0,0 +1,340 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Control flow graph builder for X86 and X64
+#include "ssde_cfg.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include "ssde_x86_length.h"
+#include "ssde_x86_flow.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+
+using ssde::CFG;
+using ssde::CFG_block;
+using ssde::CFG_edge;
+using ssde::Flow;
+using ssde::Arena;
+using ssde::Mode_x86;
+using ssde::Mode_x64;
+using ssde::Length_x86;
+using ssde::Length_x64;
+using ssde::detail::Prefix_run;
+using ssde::detail::scan_prefixes_scalar;
+using ssde::detail::decode_length;
+using ssde::detail::classify;
+using ssde::detail::ends_block;
+using std::vector;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::int64_t;
+
+
+namespace
+{
+
+const size_t page_bits = 4096;
+const size_t not_found = static_cast<size_t>(-1);
+
+} // namespace
+
+
+void CFG::Byte_set::reset(Arena& in_arena, size_t size)
+{
+	arena = &in_arena;
+	pages.assign((size + page_bits - 1) / page_bits, nullptr);
+}
+
+bool CFG::Byte_set::test(size_t pos) const
+{
+	const uint64_t* page = pages[pos / page_bits];
+	size_t bit = pos % page_bits;
+
+	return page && (page[bit / 64] >> (bit % 64) & 1);
+}
+
+void CFG::Byte_set::set(size_t pos)
+{
+	uint64_t*& page = pages[pos / page_bits];
+	size_t bit = pos % page_bits;
+
+	if (!page)
+	{
+		page = arena->allocate<uint64_t>(page_bits / 64);
+		std::memset(page, 0, page_bits / 8);
+	}
+
+	page[bit / 64] |= uint64_t(1) << (bit % 64);
+}
+
+void CFG::build_x86(const uint8_t* buffer, size_t size,
+                    const size_t* entries, size_t entry_count,
+                    bool follow_calls)
+{
+	build<Mode_x86, Length_x86>(buffer, size, entries, entry_count,
+	                            follow_calls);
+}
+
+void CFG::build_x64(const uint8_t* buffer, size_t size,
+                    const size_t* entries, size_t entry_count,
+                    bool follow_calls)
+{
+	build<Mode_x64, Length_x64>(buffer, size, entries, entry_count,
+	                            follow_calls);
+}
+
+template <typename Mode, typename Length>
+void CFG::build(const uint8_t* buffer, size_t size,
+                const size_t* entries, size_t entry_count, bool follow_calls)
+{
+	arena.clear();
+	insts.clear();
+	work.clear();
+	decoded.reset(arena, size);
+	leaders.reset(arena, size);
+
+	auto visit = [&](size_t pos)
+	{
+		leaders.set(pos);
+
+		if (!decoded.test(pos))
+			work.push_back(pos);
+	};
+
+	for (size_t i = 0; i < entry_count; ++i)
+	{
+		if (entries[i] < size)
+			visit(entries[i]);
+	}
+
+	while (!work.empty())
+	{
+		size_t pos = work.back();
+		work.pop_back();
+
+		bool chained = false;
+
+		// Decode until control leaves or runs into code decoded before
+		while (pos < size)
+		{
+			if (decoded.test(pos))
+			{
+				leaders.set(pos);
+				break;
+			}
+
+			if (chained)
+				insts.back().chained = true;
+
+			Prefix_run run = scan_prefixes_scalar<Mode>(buffer, size, pos);
+			Length len = decode_length<Mode, Length>(buffer, size, pos, run);
+
+			Inst inst;
+			inst.pos    = pos;
+			inst.length = static_cast<uint8_t>(len.length);
+			inst.flow   = len.has_error() ? Flow::stop :
+			              classify(buffer, size, pos + run.length);
+
+			int64_t target = static_cast<int64_t>(pos) + len.rel;
+
+			inst.direct = len.has_rel && target >= 0 &&
+			              static_cast<uint64_t>(target) < size;
+			inst.target = inst.direct ? static_cast<size_t>(target) : 0;
+			inst.chained = false;
+
+			insts.push_back(inst);
+			decoded.set(pos);
+
+			pos += inst.length;
+
+			if (inst.direct &&
+			    (inst.flow != Flow::call || follow_calls))
+			{
+				visit(inst.target);
+			}
+
+			if (inst.flow == Flow::branch && pos < size)
+				leaders.set(pos);
+
+			if (ends_block(inst.flow) && inst.flow != Flow::branch)
+				break;
+
+			chained = true;
+		}
+	}
+
+	make_blocks();
+}
+
+void CFG::make_blocks()
+{
+	// Index of the instruction after i in the same block, not_found if i
+	// is the last one. Instructions that fall through to one another were
+	// decoded one after another, so no lookups are needed.
+	auto next_in_block = [this](size_t i)
+	{
+		if (ends_block(insts[i].flow) || !insts[i].chained ||
+		    leaders.test(insts[i + 1].pos))
+		{
+			return not_found;
+		}
+
+		return i + 1;
+	};
+
+	// Leaders in order of address, so that blocks come out sorted
+	work.clear();
+
+	size_t calls = 0;
+
+	for (size_t i = 0; i < insts.size(); ++i)
+	{
+		if (leaders.test(insts[i].pos))
+			work.push_back(i);
+
+		if (insts[i].flow == Flow::call && insts[i].direct)
+			calls++;
+	}
+
+	std::sort(work.begin(), work.end(), [this](size_t a, size_t b)
+	{
+		return insts[a].pos < insts[b].pos;
+	});
+
+	block_count_ = work.size();
+	blocks_ = arena.allocate<CFG_block>(block_count_);
+
+	for (size_t b = 0; b < block_count_; ++b)
+	{
+		CFG_block& block = blocks_[b];
+		block = CFG_block();
+		block.start = insts[work[b]].pos;
+
+		size_t last = work[b];
+
+		for (size_t j = work[b]; j != not_found; j = next_in_block(j))
+		{
+			last = j;
+			block.inst_count++;
+		}
+
+		block.end  = insts[last].pos + insts[last].length;
+		block.exit = insts[last].flow;
+	}
+
+	// Every block has at most two edges besides those of its calls
+	edges_ = arena.allocate<CFG_edge>(block_count_ * 2 + calls);
+	edge_count_ = 0;
+
+	auto add_edge = [this](uint32_t from, size_t to_pos, CFG_edge::Kind kind)
+	{
+		uint32_t to = find_block(to_pos);
+
+		if (to == no_block)
+			return;
+
+		CFG_edge& edge = edges_[edge_count_++];
+		edge.from = from;
+		edge.to   = to;
+		edge.kind = kind;
+	};
+
+	for (size_t b = 0; b < block_count_; ++b)
+	{
+		CFG_block& block = blocks_[b];
+		block.first_edge = static_cast<uint32_t>(edge_count_);
+
+		const uint32_t from = static_cast<uint32_t>(b);
+		size_t last = work[b];
+
+		for (size_t j = work[b]; j != not_found; j = next_in_block(j))
+		{
+			last = j;
+
+			if (insts[j].flow == Flow::call && insts[j].direct)
+				add_edge(from, insts[j].target, CFG_edge::Kind::call);
+		}
+
+		const Inst& exit = insts[last];
+
+		switch (exit.flow)
+		{
+		case Flow::branch:
+			add_edge(from, exit.target, CFG_edge::Kind::taken);
+			add_edge(from, block.end, CFG_edge::Kind::fall_through);
+			break;
+
+		case Flow::jump:
+			if (exit.direct)
+				add_edge(from, exit.target, CFG_edge::Kind::jump);
+			break;
+
+		case Flow::none:
+		case Flow::call:
+			add_edge(from, block.end, CFG_edge::Kind::fall_through);
+			break;
+
+		default:
+			break;
+		}
+
+		block.edge_count = static_cast<uint32_t>(edge_count_) -
+		                   block.first_edge;
+	}
+}
+
+uint32_t CFG::find_block(size_t pos) const
+{
+	const CFG_block* begin = blocks_;
+	const CFG_block* end = blocks_ + block_count_;
+	const CFG_block* it = std::lower_bound(begin, end, pos,
+	                                       [](const CFG_block& block, size_t p)
+	{
+		return block.start < p;
+	});
+
+	return it != end && it->start == pos ?
+	       static_cast<uint32_t>(it - begin) : no_block;
+}
+
+uint32_t CFG::block_at(size_t pos) const
+{
+	const CFG_block* begin = blocks_;
+	const CFG_block* end = blocks_ + block_count_;
+	const CFG_block* it = std::upper_bound(begin, end, pos,
+	                                       [](size_t p, const CFG_block& block)
+	{
+		return p < block.start;
+	});
+
+	if (it == begin || pos >= (it - 1)->end)
+		return no_block;
+
+	return static_cast<uint32_t>(it - 1 - begin);
+}
+
+constexpr uint32_t CFG::no_block;
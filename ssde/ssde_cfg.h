@@ -0,0 +1,182 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_CFG_H
+#define SSDE_CFG_H
+
+#include "ssde_arena.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace ssde
+{
+
+// How an instruction passes control on
+enum class Flow : std::uint8_t
+{
+	none   = 0, // falls through to the next instruction
+	branch = 1, // conditional branch, falls through if not taken
+	jump   = 2, // unconditional jump
+	call   = 3, // call, assumed to return to the next instruction
+	ret    = 4, // return
+	stop   = 5, // HLT, UD2, INT3 or an instruction that failed to decode
+};
+
+struct CFG_block
+{
+	std::size_t start = 0; // offset of the first instruction
+	std::size_t end   = 0; // offset past the last instruction
+
+	std::uint32_t inst_count = 0;
+
+	// Outgoing edges are edges()[first_edge] to edges()[first_edge +
+	// edge_count - 1]
+	std::uint32_t first_edge = 0;
+	std::uint32_t edge_count = 0;
+
+	// Flow of the last instruction. A jump or branch without an edge to a
+	// block is indirect or leads out of the buffer.
+	Flow exit = Flow::none;
+};
+
+struct CFG_edge
+{
+	enum class Kind : std::uint8_t
+	{
+		fall_through = 0, // next block, including not taken branches
+		taken        = 1, // taken conditional branch
+		jump         = 2, // direct jump
+		call         = 3, // direct call, from the block the call is in
+	};
+
+	std::uint32_t from = 0; // block index
+	std::uint32_t to   = 0;
+	Kind kind = Kind::fall_through;
+};
+
+// Control flow graph built by recursive traversal. Starting from the entry
+// points, code is followed through fall-through, branches, jumps and (if
+// asked to) calls, until every reachable direct target was visited. Each
+// instruction is decoded once, no matter how many paths reach it.
+//
+// Blocks are sorted by start and split at every target, so that each block
+// is entered only at its start. Calls don't end a block. Blocks and edges are
+// kept in an arena, which a CFG reuses when it is built again.
+class CFG
+{
+public:
+	static constexpr std::uint32_t no_block = 0xffffffff;
+
+	CFG()
+	{
+	}
+
+	void build_x86(const std::uint8_t* buffer, std::size_t size,
+	               const std::size_t* entries, std::size_t entry_count,
+	               bool follow_calls = true);
+
+	void build_x64(const std::uint8_t* buffer, std::size_t size,
+	               const std::size_t* entries, std::size_t entry_count,
+	               bool follow_calls = true);
+
+	const CFG_block* blocks() const
+	{
+		return blocks_;
+	}
+
+	std::size_t block_count() const
+	{
+		return block_count_;
+	}
+
+	const CFG_edge* edges() const
+	{
+		return edges_;
+	}
+
+	std::size_t edge_count() const
+	{
+		return edge_count_;
+	}
+
+	// Index of the block starting at pos, no_block if there is none
+	std::uint32_t find_block(std::size_t pos) const;
+
+	// Index of the block pos is in, no_block if there is none. Where blocks
+	// overlap (a jump into the middle of an instruction), the one starting
+	// last is returned.
+	std::uint32_t block_at(std::size_t pos) const;
+
+	// Instructions decoded while building the graph
+	std::size_t inst_count() const
+	{
+		return insts.size();
+	}
+
+private:
+	template <typename Mode, typename Length>
+	void build(const std::uint8_t* buffer, std::size_t size,
+	           const std::size_t* entries, std::size_t entry_count,
+	           bool follow_calls);
+
+	void make_blocks();
+
+	struct Inst
+	{
+		std::size_t pos;
+		std::size_t target; // valid for direct branches, jumps and calls
+		std::uint8_t length;
+		Flow flow;
+		bool direct;
+		bool chained; // next instruction was decoded right after this one
+	};
+
+	// Bit per byte of the buffer, with 4 KB pages allocated on first use
+	class Byte_set
+	{
+	public:
+		void reset(Arena& arena, std::size_t size);
+		bool test(std::size_t pos) const;
+		void set(std::size_t pos);
+
+	private:
+		Arena* arena = nullptr;
+		std::vector<std::uint64_t*> pages;
+	};
+
+	Arena arena;
+
+	// Work memory, kept between builds
+	std::vector<Inst> insts;
+	std::vector<std::size_t> work;
+	Byte_set decoded;
+	Byte_set leaders;
+
+	CFG_block*  blocks_ = nullptr;
+	std::size_t block_count_ = 0;
+	CFG_edge*   edges_ = nullptr;
+	std::size_t edge_count_ = 0;
+};
+
+} // namespace ssde
+
+#endif // SSDE_CFG_H
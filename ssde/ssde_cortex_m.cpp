@@ -0,0 +1,296 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Vector table driven traversal of Cortex-M firmware
+#include "ssde_cortex_m.h"
+#include "ssde_arm.h"
+#include "ssde_reader.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+
+using ssde::Cortex_m_firmware;
+using ssde::Firmware_code;
+using ssde::Firmware_vector;
+using ssde::Firmware_range;
+using ssde::Inst_ARM;
+using ssde::detail::Reader;
+using std::vector;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+
+namespace
+{
+
+// 16 system exceptions and up to 496 interrupts
+const uint32_t max_vectors = 512;
+
+// Cases of a TBB or TBH followed at most
+const size_t max_cases = 1024;
+
+// Exceptions 7..10 and 13 are reserved, their slots may hold anything (a
+// checksum, on NXP parts)
+bool is_reserved(uint32_t number)
+{
+	return number < 16 && (0x2780 >> number & 1);
+}
+
+// Address in [low, high] with the most trailing zeros
+uint32_t most_aligned(uint32_t low, uint32_t high)
+{
+	if (low == 0)
+		return 0;
+
+	for (int bit = 31; bit > 0; --bit)
+	{
+		uint32_t candidate = high & ~((uint32_t(1) << bit) - 1);
+
+		if (candidate >= low)
+			return candidate;
+	}
+
+	return high;
+}
+
+} // namespace
+
+
+bool Cortex_m_firmware::open(const char* path, uint32_t base)
+{
+	if (!file.open(path))
+		return false;
+
+	return parse(file.data(), file.size(), base);
+}
+
+bool Cortex_m_firmware::parse(const uint8_t* in_data, size_t in_size,
+                              uint32_t base)
+{
+	data = in_data;
+	size = in_size;
+	base_ = 0;
+	initial_sp_ = 0;
+	vectors_.clear();
+
+	Reader in(data, size);
+
+	if (!in.contains(0, 8))
+		return false;
+
+	initial_sp_ = in.u32(0);
+	const uint32_t reset = in.u32(4);
+
+	if (!(reset & 1))
+		return false;
+
+	if (base == detect_base)
+	{
+		// System handlers must all point into the image, past the first
+		// two entries of the table
+		uint32_t low = reset & ~1u;
+		uint32_t high = low;
+
+		for (uint32_t n = 2; n < 16 && in.contains(n * 4, 4); ++n)
+		{
+			const uint32_t v = in.u32(n * 4);
+
+			if (is_reserved(n) || !(v & 1))
+				continue;
+
+			low  = std::min(low, v & ~1u);
+			high = std::max(high, v & ~1u);
+		}
+
+		// base is in (high - size, low - 8]
+		const uint64_t first = high >= size ? high - size + 1 : 0;
+
+		if (low < 8 || first > low - 8)
+			return false;
+
+		base = most_aligned(static_cast<uint32_t>(first), low - 8);
+	}
+
+	base_ = base;
+
+	if (!contains(reset & ~1u))
+		return false;
+
+	// The table ends before the code it points to
+	uint64_t table_end = size;
+
+	for (uint32_t n = 1; n < max_vectors; ++n)
+	{
+		if (uint64_t(n) * 4 + 4 > table_end)
+			break;
+
+		const uint32_t v = in.u32(n * 4);
+
+		if (is_reserved(n) || v == 0)
+			continue;
+
+		if (!(v & 1) || !contains(v & ~1u))
+		{
+			if (n < 16)
+				continue;
+
+			break;
+		}
+
+		Firmware_vector vector;
+		vector.number  = n;
+		vector.address = v & ~1u;
+		vectors_.push_back(vector);
+
+		table_end = std::min<uint64_t>(table_end, vector.address - base_);
+	}
+
+	return true;
+}
+
+Firmware_code Cortex_m_firmware::traverse() const
+{
+	Firmware_code code;
+	Reader in(data, size);
+
+	// Per halfword: 0 if not decoded, 1 if an instruction starts there, 2 if
+	// it is the second half of a 32 bit one
+	vector<uint8_t> state(size / 2 + 1, 0);
+	vector<size_t> work;
+
+	auto visit = [&](uint64_t address, bool is_function)
+	{
+		address &= ~uint64_t(1);
+
+		if (address < base_ || address - base_ >= size)
+			return;
+
+		if (is_function)
+			code.functions.push_back(static_cast<uint32_t>(address));
+
+		const size_t pos = static_cast<size_t>(address - base_);
+
+		if (!state[pos / 2])
+			work.push_back(pos);
+	};
+
+	for (const Firmware_vector& vector : vectors_)
+		visit(vector.address, true);
+
+	while (!work.empty())
+	{
+		size_t pos = work.back();
+		work.pop_back();
+
+		uint8_t it_state = 0;
+
+		// Decode until control leaves or runs into code decoded before
+		while (pos < size && !state[pos / 2])
+		{
+			const Inst_ARM inst(data, size, pos, Inst_ARM::CPU_state::thumb,
+			                    it_state);
+
+			if (inst.has_error())
+				break;
+
+			state[pos / 2] = 1;
+
+			if (inst.length == 4 && !state[pos / 2 + 1])
+				state[pos / 2 + 1] = 2;
+
+			code.inst_count++;
+
+			const uint32_t hw1 = in.u16(pos);
+			const uint32_t hw2 = in.u16(pos + 2);
+			const size_t next = pos + inst.length;
+
+			// CBZ and CBNZ test a register rather than a condition
+			const bool conditional = inst.cond != Inst_ARM::Exec_cond::al ||
+			                         (hw1 & 0xf500) == 0xb100;
+
+			if (inst.length == 4 && hw1 == 0xe8df && (hw2 & 0xffe0) == 0xf000)
+			{
+				// TBB [PC, Rm], TBH [PC, Rm, LSL #1]. Cases come after the
+				// table, so it can't run past the lowest case seen.
+				const size_t entry = (hw2 & 0x10) ? 2 : 1;
+				size_t limit = size;
+
+				for (size_t at = next, i = 0;
+				     at + entry <= limit && i < max_cases; at += entry, ++i)
+				{
+					const size_t target = next + 2 * in.read(at, entry);
+
+					if (target < at + entry || target >= size)
+						break;
+
+					limit = std::min(limit, target);
+					visit(uint64_t(base_) + target, false);
+				}
+			}
+
+			if (inst.is_branch)
+			{
+				if (inst.has_rel)
+					visit(uint64_t(base_) + pos + inst.rel, inst.has_link);
+
+				if (!inst.has_link && !conditional)
+					break;
+			}
+
+			it_state = inst.it_state;
+			pos = next;
+		}
+	}
+
+	std::sort(code.functions.begin(), code.functions.end());
+	code.functions.erase(std::unique(code.functions.begin(),
+	                                 code.functions.end()),
+	                     code.functions.end());
+
+	for (size_t i = 0; i < state.size(); )
+	{
+		if (!state[i])
+		{
+			++i;
+			continue;
+		}
+
+		size_t j = i;
+
+		while (j < state.size() && state[j])
+			++j;
+
+		Firmware_range range;
+		range.start = base_ + static_cast<uint32_t>(i * 2);
+		range.end   = base_ + static_cast<uint32_t>(std::min(j * 2, size));
+		code.ranges.push_back(range);
+
+		i = j;
+	}
+
+	return code;
+}
+
+constexpr uint32_t Cortex_m_firmware::detect_base;
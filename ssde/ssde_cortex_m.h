@@ -0,0 +1,130 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_CORTEX_M_H
+#define SSDE_CORTEX_M_H
+
+#include "ssde_image.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace ssde
+{
+
+// Exception handler found in the vector table
+struct Firmware_vector
+{
+	std::uint32_t number  = 0; // exception number, 1 for reset, 16+n for IRQn
+	std::uint32_t address = 0; // handler address, Thumb bit cleared
+};
+
+// [start, end) addresses of code reached by traversal
+struct Firmware_range
+{
+	std::uint32_t start = 0;
+	std::uint32_t end   = 0;
+};
+
+// Code reached from the exception handlers
+struct Firmware_code
+{
+	// Handlers and targets of BL, sorted and without duplicates
+	std::vector<std::uint32_t> functions;
+
+	// Bytes decoded as instructions, sorted and merged
+	std::vector<Firmware_range> ranges;
+
+	std::size_t inst_count = 0;
+};
+
+// Bare-metal Cortex-M image (raw flash contents, as in a .bin file), which
+// starts with the vector table: the initial stack pointer followed by the
+// addresses of the exception handlers, each with the Thumb bit set.
+//
+// Instead of sweeping the whole image, which is mostly literal pools and
+// constant data, code is found by recursive traversal from the handlers.
+class Cortex_m_firmware
+{
+public:
+	// Pass as base to have it guessed from the handler addresses
+	static constexpr std::uint32_t detect_base = 0xffffffff;
+
+	Cortex_m_firmware()
+	{
+	}
+
+	// Maps and parses path, returns false if it doesn't start with a vector
+	// table
+	bool open(const char* path, std::uint32_t base = detect_base);
+
+	// Parses an image already in memory, which must outlive the
+	// Cortex_m_firmware. base is the address the image is linked at, the
+	// start of flash on most parts (0x08000000 on STM32, 0 on nRF5x). If it
+	// is detected, the base picked is the most aligned address the vector
+	// table can be at for its handlers to point into the image.
+	bool parse(const std::uint8_t* data, std::size_t size,
+	           std::uint32_t base = detect_base);
+
+	std::uint32_t base() const
+	{
+		return base_;
+	}
+
+	std::uint32_t initial_sp() const
+	{
+		return initial_sp_;
+	}
+
+	// Handlers pointing into the image, in table order. The table is read
+	// up to the first entry that isn't a handler or a 0 and never past the
+	// lowest handler.
+	const std::vector<Firmware_vector>& vectors() const
+	{
+		return vectors_;
+	}
+
+	// Follows Thumb code from every handler through branches and calls.
+	// Paths end at unconditional jumps, returns (BX, POP {PC}, LDR PC) and
+	// undefined instructions. TBB and TBH with a table right after them are
+	// followed into each case.
+	Firmware_code traverse() const;
+
+private:
+	bool contains(std::uint32_t address) const
+	{
+		return address >= base_ && address - base_ < size;
+	}
+
+	Mapped_file file;
+
+	const std::uint8_t* data = nullptr;
+	std::size_t size = 0;
+
+	std::uint32_t base_ = 0;
+	std::uint32_t initial_sp_ = 0;
+
+	std::vector<Firmware_vector> vectors_;
+};
+
+} // namespace ssde
+
+#endif // SSDE_CORTEX_M_H
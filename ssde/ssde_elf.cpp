@@ -0,0 +1,260 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// ELF reader
+#include "ssde_elf.h"
+#include "ssde_image.h"
+#include "ssde_reader.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+using ssde::Elf_file;
+using ssde::Image_section;
+using ssde::Arch;
+using ssde::detail::Reader;
+using std::size_t;
+using std::uint8_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+
+
+// Field offsets are those of the ELF specification, with the ELF32 layout
+// first and the ELF64 one second. Only little endian files are read, which
+// is all X86 ever uses.
+
+namespace
+{
+
+const uint8_t ei_class_32 = 1;
+const uint8_t ei_class_64 = 2;
+const uint8_t ei_data_lsb = 1;
+
+const uint16_t em_386    = 3;
+const uint16_t em_x86_64 = 62;
+
+const uint32_t sht_nobits     = 8;
+const uint64_t shf_execinstr  = 0x4;
+const uint16_t shn_xindex     = 0xffff;
+
+const uint32_t pt_load = 1;
+const uint32_t pf_x    = 0x1;
+
+// Reader of fields that are at different offsets in ELF32 and ELF64, and
+// are 4 or 8 bytes wide depending on the class
+class Elf_reader : public Reader
+{
+public:
+	Elf_reader(const uint8_t* data, size_t size, bool is_64)
+		: Reader(data, size), is_64(is_64)
+	{
+	}
+
+	using Reader::u32;
+
+	// Address or offset sized field, at pos32 or pos64
+	uint64_t word(uint64_t base, size_t pos32, size_t pos64) const
+	{
+		return is_64 ? u64(base + pos64) : u32(base + pos32);
+	}
+
+	uint16_t half(uint64_t base, size_t pos32, size_t pos64) const
+	{
+		return u16(base + (is_64 ? pos64 : pos32));
+	}
+
+	uint32_t u32(uint64_t base, size_t pos32, size_t pos64) const
+	{
+		return u32(base + (is_64 ? pos64 : pos32));
+	}
+
+	bool is_64;
+};
+
+} // namespace
+
+
+bool Elf_file::open(const char* path, bool huge_pages)
+{
+	if (!file.open(path, huge_pages))
+		return false;
+
+	return parse(file.data(), file.size());
+}
+
+bool Elf_file::parse(const uint8_t* in_data, size_t in_size)
+{
+	data = in_data;
+	size = in_size;
+	arch_ = Arch::unknown;
+	entry_ = 0;
+	sections_.clear();
+
+	if (size < 52 || std::memcmp(data, "\x7f" "ELF", 4) != 0)
+		return false;
+
+	if (data[5] != ei_data_lsb)
+		return false;
+
+	if (data[4] == ei_class_32)
+		is_64_ = false;
+	else if (data[4] == ei_class_64 && size >= 64)
+		is_64_ = true;
+	else
+		return false;
+
+	Elf_reader in(data, size, is_64_);
+
+	switch (in.u16(18))
+	{
+	case em_386:
+		arch_ = Arch::x86;
+		break;
+
+	case em_x86_64:
+		arch_ = Arch::x64;
+		break;
+	}
+
+	entry_ = in.word(0, 24, 24);
+
+	return parse_sections() || parse_segments();
+}
+
+bool Elf_file::parse_sections()
+{
+	Elf_reader in(data, size, is_64_);
+
+	const uint64_t shoff     = in.word(0, 32, 40);
+	const uint16_t shentsize = in.half(0, 46, 58);
+	uint64_t shnum           = in.half(0, 48, 60);
+	uint32_t shstrndx        = in.half(0, 50, 62);
+
+	if (shoff == 0 || shentsize < (is_64_ ? 64 : 40))
+		return false;
+
+	// Files with many sections keep the real counts in section 0
+	if (shnum == 0)
+		shnum = in.word(shoff, 20, 32);
+
+	if (shstrndx == shn_xindex)
+		shstrndx = in.u32(shoff, 24, 40);
+
+	if (shnum == 0 || !in.contains(shoff, shnum, shentsize))
+		return false;
+
+	const uint64_t strtab = shoff + uint64_t(shstrndx) * shentsize;
+	const uint64_t names  = shstrndx < shnum ? in.word(strtab, 16, 24) : 0;
+	const uint64_t names_size = shstrndx < shnum ? in.word(strtab, 20, 32) : 0;
+
+	for (uint64_t i = 0; i < shnum; ++i)
+	{
+		const uint64_t header = shoff + i * shentsize;
+
+		const uint32_t type   = in.u32(header + 4);
+		const uint64_t flags  = in.word(header, 8, 8);
+		const uint64_t addr   = in.word(header, 12, 16);
+		const uint64_t offset = in.word(header, 16, 24);
+		const uint64_t bytes  = in.word(header, 20, 32);
+
+		if (!(flags & shf_execinstr) || type == sht_nobits || bytes == 0 ||
+		    !in.contains(offset, bytes))
+		{
+			continue;
+		}
+
+		Image_section section;
+		section.address = addr;
+		section.data = data + offset;
+		section.size = static_cast<size_t>(bytes);
+
+		const uint32_t name = in.u32(header);
+
+		if (names != 0 && name < names_size && in.contains(names, names_size))
+		{
+			const char* begin = reinterpret_cast<const char*>(data + names + name);
+			section.name.assign(begin, strnlen(begin, names_size - name));
+		}
+
+		sections_.push_back(section);
+	}
+
+	return !sections_.empty();
+}
+
+bool Elf_file::parse_segments()
+{
+	Elf_reader in(data, size, is_64_);
+
+	const uint64_t phoff     = in.word(0, 28, 32);
+	const uint16_t phentsize = in.half(0, 42, 54);
+	const uint16_t phnum     = in.half(0, 44, 56);
+
+	if (phoff == 0 || phentsize < (is_64_ ? 56 : 32) ||
+	    !in.contains(phoff, phnum, phentsize))
+	{
+		return false;
+	}
+
+	for (uint16_t i = 0; i < phnum; ++i)
+	{
+		const uint64_t header = phoff + uint64_t(i) * phentsize;
+
+		const uint32_t type   = in.u32(header);
+		const uint32_t flags  = in.u32(header, 24, 4);
+		const uint64_t offset = in.word(header, 4, 8);
+		const uint64_t vaddr  = in.word(header, 8, 16);
+		const uint64_t bytes  = in.word(header, 16, 32);
+
+		if (type != pt_load || !(flags & pf_x) || bytes == 0 ||
+		    !in.contains(offset, bytes))
+		{
+			continue;
+		}
+
+		Image_section section;
+		section.address = vaddr;
+		section.data = data + offset;
+		section.size = static_cast<size_t>(bytes);
+
+		sections_.push_back(section);
+	}
+
+	return !sections_.empty();
+}
+
+const Image_section* Elf_file::find_section(uint64_t address) const
+{
+	for (const Image_section& section : sections_)
+	{
+		if (address >= section.address &&
+		    address - section.address < section.size)
+		{
+			return &section;
+		}
+	}
+
+	return nullptr;
+}
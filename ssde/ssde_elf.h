@@ -0,0 +1,92 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_ELF_H
+#define SSDE_ELF_H
+
+#include "ssde_image.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace ssde
+{
+
+// ELF32/ELF64 reader. Finds the code of an executable or shared object and
+// the decoder it needs; code is read in place, out of the mapped file.
+class Elf_file
+{
+public:
+	Elf_file()
+	{
+	}
+
+	// Maps and parses path, returns false if it isn't an ELF file this
+	// reader understands
+	bool open(const char* path, bool huge_pages = false);
+
+	// Parses an image already in memory, which must outlive the Elf_file
+	bool parse(const std::uint8_t* data, std::size_t size);
+
+	// x86 for EM_386, x64 for EM_X86_64, unknown for anything else
+	Arch arch() const
+	{
+		return arch_;
+	}
+
+	bool is_64() const
+	{
+		return is_64_;
+	}
+
+	std::uint64_t entry() const
+	{
+		return entry_;
+	}
+
+	// Executable sections (SHF_EXECINSTR), in file order. If the section
+	// headers were stripped, executable PT_LOAD segments instead.
+	const std::vector<Image_section>& sections() const
+	{
+		return sections_;
+	}
+
+	// Section containing virtual address, nullptr if none does
+	const Image_section* find_section(std::uint64_t address) const;
+
+private:
+	bool parse_sections();
+	bool parse_segments();
+
+	Mapped_file file;
+
+	const std::uint8_t* data = nullptr;
+	std::size_t size = 0;
+
+	Arch arch_ = Arch::unknown;
+	bool is_64_ = false;
+	std::uint64_t entry_ = 0;
+	std::vector<Image_section> sections_;
+};
+
+} // namespace ssde
+
+#endif // SSDE_ELF_H
@@ -0,0 +1,261 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// File mapping and code section sweep
+#include "ssde_image.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+using ssde::Mapped_file;
+using ssde::Image_section;
+using ssde::Image_batch;
+using ssde::Arch;
+using std::vector;
+using std::size_t;
+using std::uint8_t;
+using std::int64_t;
+
+
+namespace
+{
+
+// Instructions per batch, small enough for the batch to stay in cache
+const size_t batch_size = 4096;
+
+template <typename Range, typename Decode_range>
+size_t sweep(const Image_section& section, size_t end,
+             Decode_range decode_range,
+             const std::function<void(const Image_batch&)>& visit)
+{
+	vector<size_t>  offset(batch_size);
+	vector<uint8_t> length(batch_size);
+	vector<int64_t> target(batch_size);
+	vector<uint8_t> has_rel(batch_size);
+	vector<uint8_t> error(batch_size);
+
+	Range out;
+
+	out.offset   = offset.data();
+	out.length   = length.data();
+	out.target   = target.data();
+	out.has_rel  = has_rel.data();
+	out.error    = error.data();
+	out.capacity = batch_size;
+
+	Image_batch batch;
+
+	batch.section = &section;
+	batch.offset  = offset.data();
+	batch.length  = length.data();
+	batch.target  = target.data();
+	batch.has_rel = has_rel.data();
+	batch.error   = error.data();
+
+	size_t total = 0;
+
+	for (size_t pos = 0; pos < end; )
+	{
+		batch.count = decode_range(section.data, section.size, pos, end, out);
+
+		visit(batch);
+
+		total += batch.count;
+		pos = offset[batch.count - 1] + length[batch.count - 1];
+	}
+
+	return total;
+}
+
+} // namespace
+
+
+Mapped_file::~Mapped_file()
+{
+	close();
+}
+
+Mapped_file::Mapped_file(Mapped_file&& other)
+	: data_(other.data_), size_(other.size_)
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+}
+
+Mapped_file& Mapped_file::operator=(Mapped_file&& other)
+{
+	if (this != &other)
+	{
+		close();
+
+		data_ = other.data_;
+		size_ = other.size_;
+		other.data_ = nullptr;
+		other.size_ = 0;
+	}
+
+	return *this;
+}
+
+#if defined(_WIN32)
+
+bool Mapped_file::open(const char* path, bool)
+{
+	close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+	                          nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0,
+	                                    nullptr);
+	CloseHandle(file);
+
+	if (!mapping)
+		return false;
+
+	// The view keeps the mapping alive
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	if (!view)
+		return false;
+
+	data_ = static_cast<const uint8_t*>(view);
+	size_ = static_cast<size_t>(file_size.QuadPart);
+
+	return true;
+}
+
+void Mapped_file::close()
+{
+	if (data_)
+		UnmapViewOfFile(data_);
+
+	data_ = nullptr;
+	size_ = 0;
+}
+
+#else
+
+bool Mapped_file::open(const char* path, bool huge_pages)
+{
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+
+	if (fstat(fd, &info) != 0 || info.st_size <= 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	const size_t size = static_cast<size_t>(info.st_size);
+	void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping holds its own reference to the file
+	::close(fd);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	madvise(map, size, MADV_SEQUENTIAL);
+
+#ifdef MADV_HUGEPAGE
+	if (huge_pages)
+		madvise(map, size, MADV_HUGEPAGE);
+#else
+	(void)huge_pages;
+#endif
+
+	data_ = static_cast<const uint8_t*>(map);
+	size_ = size;
+
+	return true;
+}
+
+void Mapped_file::close()
+{
+	if (data_)
+		munmap(const_cast<uint8_t*>(data_), size_);
+
+	data_ = nullptr;
+	size_ = 0;
+}
+
+#endif
+
+size_t ssde::image_sweep(Arch arch, const Image_section& section,
+                         const std::function<void(const Image_batch&)>& visit)
+{
+	return image_sweep(arch, section, section.size, visit);
+}
+
+size_t ssde::image_sweep(Arch arch, const Image_section& section, size_t end,
+                         const std::function<void(const Image_batch&)>& visit)
+{
+	end = std::min(end, section.size);
+
+	switch (arch)
+	{
+	case Arch::x86:
+		return sweep<ssde::Range_x86>(section, end, ssde::x86_decode_range,
+		                              visit);
+
+	case Arch::x64:
+		return sweep<ssde::Range_x64>(section, end, ssde::x64_decode_range,
+		                              visit);
+
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,121 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_IMAGE_H
+#define SSDE_IMAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+
+// Executable images on disk: read-only file mapping, code sections found by
+// the format readers (ssde_elf.h) and a driver sweeping them in place.
+
+namespace ssde
+{
+
+enum class Arch : std::uint8_t
+{
+	unknown = 0,
+	x86     = 1,
+	x64     = 2,
+};
+
+// Read-only, private mapping of a whole file
+class Mapped_file
+{
+public:
+	Mapped_file()
+	{
+	}
+
+	~Mapped_file();
+
+	Mapped_file(const Mapped_file&) = delete;
+	Mapped_file& operator=(const Mapped_file&) = delete;
+
+	Mapped_file(Mapped_file&& other);
+	Mapped_file& operator=(Mapped_file&& other);
+
+	// Maps path, returns false if it can't be. The kernel is told that the
+	// file will be read front to back and, if huge_pages is set, that it may
+	// back the mapping with huge pages. Both are hints only.
+	bool open(const char* path, bool huge_pages = false);
+
+	void close();
+
+	const std::uint8_t* data() const
+	{
+		return data_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	const std::uint8_t* data_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+// Code section of an image. data points into the mapped file, nothing is
+// copied.
+struct Image_section
+{
+	std::string name; // empty for segments
+	std::uint64_t address = 0; // virtual address of data[0]
+	const std::uint8_t* data = nullptr;
+	std::size_t size = 0;
+};
+
+// Instructions decoded by image_sweep, as in Range_x86/Range_x64. Offsets
+// and targets are relative to section->data; add section->address for
+// virtual addresses.
+struct Image_batch
+{
+	const Image_section* section = nullptr;
+
+	const std::size_t*   offset  = nullptr;
+	const std::uint8_t*  length  = nullptr;
+	const std::int64_t*  target  = nullptr;
+	const std::uint8_t*  has_rel = nullptr;
+	const std::uint8_t*  error   = nullptr;
+	std::size_t count = 0;
+};
+
+// Linear sweep over section with the decoder for arch, straight out of the
+// mapping. Instructions are handed to visit a batch at a time, the batch is
+// only valid during the call. Returns the number of instructions decoded, 0
+// if arch is unknown.
+std::size_t image_sweep(Arch arch, const Image_section& section,
+                        const std::function<void(const Image_batch&)>& visit);
+
+// Same, but only instructions starting before end are decoded. The last one
+// may extend past end, but never past section.size.
+std::size_t image_sweep(Arch arch, const Image_section& section,
+                        std::size_t end,
+                        const std::function<void(const Image_batch&)>& visit);
+
+} // namespace ssde
+
+#endif // SSDE_IMAGE_H
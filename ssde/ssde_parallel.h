@@ -0,0 +1,76 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_PARALLEL_H
+#define SSDE_PARALLEL_H
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// Threading helpers of the parallel drivers (ssde_sweep.cpp and others).
+// Not a part of the public interface.
+
+namespace ssde
+{
+namespace detail
+{
+
+// Number of threads to use when the caller passed 0
+inline unsigned default_threads(unsigned threads)
+{
+	if (threads != 0)
+		return threads;
+
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// Runs task(i) for i in [0, count) on up to threads threads, the calling
+// thread included. Tasks are handed out one at a time, so uneven tasks
+// don't leave threads idle.
+template <typename Task>
+void parallel_for(std::size_t count, unsigned threads, Task task)
+{
+	std::atomic<std::size_t> next{0};
+
+	auto worker = [&]
+	{
+		for (std::size_t i = next++; i < count; i = next++)
+			task(i);
+	};
+
+	std::vector<std::thread> pool;
+
+	for (unsigned i = 1; i < threads && i < count; ++i)
+		pool.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : pool)
+		thread.join();
+}
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_PARALLEL_H
@@ -0,0 +1,305 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// PE reader
+#include "ssde_pe.h"
+#include "ssde_image.h"
+#include "ssde_reader.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+
+using ssde::Pe_file;
+using ssde::Image_section;
+using ssde::Arch;
+using ssde::detail::Reader;
+using std::vector;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+
+
+// Field offsets are those of the PE/COFF specification (winnt.h names in
+// comments).
+
+namespace
+{
+
+const uint16_t machine_i386  = 0x014c;
+const uint16_t machine_amd64 = 0x8664;
+
+const uint16_t magic_pe32      = 0x010b;
+const uint16_t magic_pe32_plus = 0x020b;
+
+const uint32_t scn_cnt_code    = 0x00000020;
+const uint32_t scn_mem_execute = 0x20000000;
+
+const uint32_t directory_export    = 0;
+const uint32_t directory_exception = 3;
+
+// RUNTIME_FUNCTION of X64: begin, end and unwind info RVAs
+const uint32_t runtime_function_size = 12;
+
+} // namespace
+
+
+bool Pe_file::open(const char* path, bool huge_pages)
+{
+	if (!file.open(path, huge_pages))
+		return false;
+
+	return parse(file.data(), file.size());
+}
+
+bool Pe_file::parse(const uint8_t* in_data, size_t in_size)
+{
+	data = in_data;
+	size = in_size;
+	arch_ = Arch::unknown;
+	entry_ = 0;
+	exports = Directory();
+	exceptions = Directory();
+	raw_sections.clear();
+	sections_.clear();
+
+	Reader in(data, size);
+
+	if (in.u16(0) != 0x5a4d) // MZ
+		return false;
+
+	const uint64_t nt = in.u32(0x3c); // e_lfanew
+
+	if (in.u32(nt) != 0x00004550) // PE\0\0
+		return false;
+
+	// IMAGE_FILE_HEADER
+	const uint64_t coff = nt + 4;
+	const uint16_t machine       = in.u16(coff + 0);
+	const uint16_t section_count = in.u16(coff + 2);
+	const uint16_t optional_size = in.u16(coff + 16);
+
+	switch (machine)
+	{
+	case machine_i386:
+		arch_ = Arch::x86;
+		break;
+
+	case machine_amd64:
+		arch_ = Arch::x64;
+		break;
+	}
+
+	// IMAGE_OPTIONAL_HEADER32/64
+	const uint64_t optional = coff + 20;
+	const uint16_t magic = in.u16(optional);
+
+	if (magic == magic_pe32)
+		is_64_ = false;
+	else if (magic == magic_pe32_plus)
+		is_64_ = true;
+	else
+		return false;
+
+	const uint32_t entry_rva = in.u32(optional + 16);
+
+	image_base_ = is_64_ ? in.u64(optional + 24) : in.u32(optional + 28);
+	header_size = in.u32(optional + 60);
+
+	const uint64_t directory_count = in.u32(optional + (is_64_ ? 108 : 92));
+	const uint64_t directories = optional + (is_64_ ? 112 : 96);
+
+	auto directory = [&](uint32_t index)
+	{
+		Directory dir;
+
+		if (index < directory_count &&
+		    (index + 1) * 8 <= optional_size - (directories - optional))
+		{
+			dir.rva  = in.u32(directories + index * 8);
+			dir.size = in.u32(directories + index * 8 + 4);
+		}
+
+		return dir;
+	};
+
+	if (optional_size > directories - optional)
+	{
+		exports    = directory(directory_export);
+		exceptions = directory(directory_exception);
+	}
+
+	// IMAGE_SECTION_HEADER
+	const uint64_t headers = optional + optional_size;
+
+	if (!in.contains(headers, uint64_t(section_count) * 40))
+		return false;
+
+	for (uint16_t i = 0; i < section_count; ++i)
+	{
+		const uint64_t header = headers + uint64_t(i) * 40;
+
+		Raw_section raw;
+		raw.virtual_size = in.u32(header + 8);
+		raw.rva          = in.u32(header + 12);
+		raw.raw_size     = in.u32(header + 16);
+		raw.raw_offset   = in.u32(header + 20);
+
+		const uint32_t characteristics = in.u32(header + 36);
+
+		raw.executable = (characteristics & (scn_mem_execute | scn_cnt_code)) != 0;
+
+		// Bytes past the end of the file aren't there to read
+		if (!in.contains(raw.raw_offset, raw.raw_size))
+		{
+			raw.raw_size = raw.raw_offset < size ?
+			               static_cast<uint32_t>(size - raw.raw_offset) : 0;
+		}
+
+		raw_sections.push_back(raw);
+
+		// Raw data is padded to the file alignment, the rest is zeros
+		// that would be decoded as add [rax], al
+		uint32_t code_size = raw.raw_size;
+
+		if (raw.virtual_size != 0)
+			code_size = std::min(code_size, raw.virtual_size);
+
+		if (!raw.executable || code_size == 0)
+			continue;
+
+		const char* name = reinterpret_cast<const char*>(data + header);
+
+		Image_section section;
+		section.name.assign(name, std::find(name, name + 8, '\0'));
+		section.address = image_base_ + raw.rva;
+		section.data = data + raw.raw_offset;
+		section.size = code_size;
+
+		sections_.push_back(section);
+	}
+
+	if (entry_rva != 0)
+		entry_ = image_base_ + entry_rva;
+
+	return true;
+}
+
+bool Pe_file::rva_to_offset(uint32_t rva, size_t& offset) const
+{
+	for (const Raw_section& raw : raw_sections)
+	{
+		if (rva >= raw.rva && rva - raw.rva < raw.raw_size)
+		{
+			offset = raw.raw_offset + (rva - raw.rva);
+			return true;
+		}
+	}
+
+	// Headers are mapped as they are in the file
+	if (rva < header_size && rva < size)
+	{
+		offset = rva;
+		return true;
+	}
+
+	return false;
+}
+
+bool Pe_file::is_code(uint32_t rva) const
+{
+	return find_section(image_base_ + rva) != nullptr;
+}
+
+const Image_section* Pe_file::find_section(uint64_t address) const
+{
+	for (const Image_section& section : sections_)
+	{
+		if (address >= section.address &&
+		    address - section.address < section.size)
+		{
+			return &section;
+		}
+	}
+
+	return nullptr;
+}
+
+vector<uint64_t> Pe_file::seeds() const
+{
+	Reader in(data, size);
+
+	vector<uint64_t> out;
+
+	auto add = [&](uint32_t rva)
+	{
+		if (rva != 0 && is_code(rva))
+			out.push_back(image_base_ + rva);
+	};
+
+	if (entry_ != 0)
+		add(static_cast<uint32_t>(entry_ - image_base_));
+
+	// IMAGE_EXPORT_DIRECTORY. Functions whose RVA points back into the
+	// export directory are forwarders, names of functions in other DLLs.
+	size_t dir;
+
+	if (exports.rva != 0 && rva_to_offset(exports.rva, dir))
+	{
+		const uint32_t count = in.u32(dir + 20);      // NumberOfFunctions
+		const uint32_t functions = in.u32(dir + 28);  // AddressOfFunctions
+		size_t table;
+
+		if (rva_to_offset(functions, table) &&
+		    in.contains(table, uint64_t(count) * 4))
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint32_t rva = in.u32(table + uint64_t(i) * 4);
+
+				if (rva - exports.rva >= exports.size)
+					add(rva);
+			}
+		}
+	}
+
+	// .pdata, X64 only. Every function that isn't a leaf has an entry.
+	if (arch_ == Arch::x64 && exceptions.rva != 0 &&
+	    rva_to_offset(exceptions.rva, dir))
+	{
+		const uint32_t count = exceptions.size / runtime_function_size;
+
+		if (in.contains(dir, uint64_t(count) * runtime_function_size))
+		{
+			for (uint32_t i = 0; i < count; ++i)
+				add(in.u32(dir + uint64_t(i) * runtime_function_size));
+		}
+	}
+
+	std::sort(out.begin(), out.end());
+	out.erase(std::unique(out.begin(), out.end()), out.end());
+
+	return out;
+}
@@ -0,0 +1,130 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_PE_H
+#define SSDE_PE_H
+
+#include "ssde_image.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace ssde
+{
+
+// PE32/PE32+ reader. Finds the code of an executable or DLL, the decoder it
+// needs and known function starts; code is read in place, out of the mapped
+// file, without loading the image.
+class Pe_file
+{
+public:
+	Pe_file()
+	{
+	}
+
+	// Maps and parses path, returns false if it isn't a PE file this reader
+	// understands
+	bool open(const char* path, bool huge_pages = false);
+
+	// Parses an image already in memory, which must outlive the Pe_file
+	bool parse(const std::uint8_t* data, std::size_t size);
+
+	// x86 for IMAGE_FILE_MACHINE_I386, x64 for IMAGE_FILE_MACHINE_AMD64,
+	// unknown for anything else
+	Arch arch() const
+	{
+		return arch_;
+	}
+
+	// PE32+
+	bool is_64() const
+	{
+		return is_64_;
+	}
+
+	std::uint64_t image_base() const
+	{
+		return image_base_;
+	}
+
+	// Virtual address of the entry point, 0 if there is none
+	std::uint64_t entry() const
+	{
+		return entry_;
+	}
+
+	// Executable sections, in file order. Addresses are virtual addresses,
+	// image_base() plus the section's RVA.
+	const std::vector<Image_section>& sections() const
+	{
+		return sections_;
+	}
+
+	// Section containing virtual address, nullptr if none does
+	const Image_section* find_section(std::uint64_t address) const;
+
+	// File offset of rva, false if it isn't backed by the file
+	bool rva_to_offset(std::uint32_t rva, std::size_t& offset) const;
+
+	// Virtual addresses of known code in executable sections, sorted and
+	// without duplicates: the entry point, exported functions (forwarders
+	// excluded) and the functions of the .pdata exception table
+	std::vector<std::uint64_t> seeds() const;
+
+private:
+	struct Raw_section
+	{
+		std::uint32_t rva;
+		std::uint32_t virtual_size;
+		std::uint32_t raw_offset;
+		std::uint32_t raw_size;
+		bool executable;
+	};
+
+	struct Directory
+	{
+		std::uint32_t rva  = 0;
+		std::uint32_t size = 0;
+	};
+
+	bool is_code(std::uint32_t rva) const;
+
+	Mapped_file file;
+
+	const std::uint8_t* data = nullptr;
+	std::size_t size = 0;
+
+	Arch arch_ = Arch::unknown;
+	bool is_64_ = false;
+	std::uint64_t image_base_ = 0;
+	std::uint64_t entry_ = 0;
+	std::uint32_t header_size = 0;
+
+	Directory exports;
+	Directory exceptions;
+
+	std::vector<Raw_section> raw_sections;
+	std::vector<Image_section> sections_;
+};
+
+} // namespace ssde
+
+#endif // SSDE_PE_H
@@ -0,0 +1,281 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Code of running processes
+#include "ssde_process.h"
+#include "ssde_image.h"
+#include "ssde_elf.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/uio.h>
+#endif
+
+
+using ssde::Process_memory;
+using ssde::Process_region;
+using ssde::Image_section;
+using ssde::Image_batch;
+using ssde::Elf_file;
+using ssde::Arch;
+using std::vector;
+using std::string;
+using std::size_t;
+using std::uint8_t;
+using std::uint64_t;
+
+
+namespace
+{
+
+// Longest instruction. A read that ends in the middle of a region leaves
+// this many bytes for the instruction starting last.
+const size_t max_length = 15;
+
+// Remote ranges per process_vm_readv call, well under IOV_MAX
+const size_t max_ranges = 256;
+
+#if defined(__linux__)
+
+// Region being read: where the next read starts and where it ends
+struct Cursor
+{
+	const Process_region* region;
+	uint64_t pos;
+};
+
+// Part of the buffer a read filled
+struct Piece
+{
+	size_t cursor;
+	size_t offset; // in the buffer
+	size_t size;
+	bool failed;   // region couldn't be read past offset + size
+};
+
+#endif
+
+} // namespace
+
+
+Process_memory::Process_memory(size_t buffer_size)
+	: buffer(std::max(buffer_size, 2 * max_length))
+{
+}
+
+#if defined(__linux__)
+
+bool Process_memory::open(int in_pid)
+{
+	pid = in_pid;
+	arch_ = Arch::unknown;
+	regions_.clear();
+
+	const string proc = "/proc/" + std::to_string(pid);
+	std::ifstream maps(proc + "/maps");
+
+	if (!maps)
+		return false;
+
+	// start-end perms offset dev inode [path]
+	for (string line; std::getline(maps, line); )
+	{
+		std::istringstream in(line);
+
+		Process_region region;
+		string range, perms, offset, dev, inode;
+		char dash;
+
+		in >> std::hex >> region.start >> dash >> region.end >> perms >> offset
+		   >> dev >> inode;
+
+		// Not readable means [vsyscall] and PROT_EXEC only mappings, which
+		// process_vm_readv can't read either
+		if (!in || perms.size() < 3 || perms[0] != 'r' || perms[2] != 'x')
+			continue;
+
+		std::getline(in >> std::ws, region.path);
+		regions_.push_back(region);
+	}
+
+	Elf_file exe;
+
+	if (exe.open((proc + "/exe").c_str()))
+		arch_ = exe.arch();
+
+	return true;
+}
+
+size_t Process_memory::read(uint64_t address, uint8_t* out, size_t size) const
+{
+	iovec local{out, size};
+	iovec remote{reinterpret_cast<void*>(address), size};
+
+	ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+
+	return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+size_t Process_memory::sweep(Arch arch,
+                             const std::function<void(const Image_batch&)>& visit)
+{
+	if (arch != Arch::x86 && arch != Arch::x64)
+		return 0;
+
+	vector<Cursor> cursors;
+
+	for (const Process_region& region : regions_)
+		cursors.push_back(Cursor{&region, region.start});
+
+	vector<iovec> remote;
+	vector<Piece> pieces;
+
+	size_t total = 0;
+	size_t next = 0; // first cursor not done yet
+
+	while (next < cursors.size())
+	{
+		remote.clear();
+		pieces.clear();
+
+		// Fill the buffer from as many regions as fit
+		size_t used = 0;
+
+		for (size_t c = next;
+		     c < cursors.size() && remote.size() < max_ranges; ++c)
+		{
+			const Cursor& cursor = cursors[c];
+			const size_t left = buffer.size() - used;
+
+			// Not worth starting a region in a sliver of buffer
+			if (left < 2 * max_length)
+				break;
+
+			const size_t size = static_cast<size_t>(
+				std::min<uint64_t>(cursor.region->end - cursor.pos, left));
+
+			remote.push_back(iovec{reinterpret_cast<void*>(cursor.pos), size});
+			pieces.push_back(Piece{c, used, size, false});
+			used += size;
+		}
+
+		iovec local{buffer.data(), used};
+
+		ssize_t result = process_vm_readv(pid, &local, 1, remote.data(),
+		                                  remote.size(), 0);
+
+		// Nothing more to read from a process that's gone
+		if (result < 0 && errno == ESRCH)
+			break;
+
+		size_t read = result > 0 ? static_cast<size_t>(result) : 0;
+
+		bytes_read_ += read;
+
+		// A failed range ends the read, ranges after it weren't read and
+		// are tried again. The failed region is skipped from where the
+		// read stopped.
+		for (Piece& piece : pieces)
+		{
+			if (piece.offset + piece.size <= read)
+				continue;
+
+			piece.failed = piece.offset <= read;
+			piece.size = piece.failed ? read - piece.offset : 0;
+		}
+
+		for (const Piece& piece : pieces)
+		{
+			Cursor& cursor = cursors[piece.cursor];
+			const uint64_t region_end = cursor.region->end;
+
+			if (piece.size != 0)
+			{
+				Image_section section;
+				section.name = cursor.region->path;
+				section.address = cursor.pos;
+				section.data = buffer.data() + piece.offset;
+				section.size = piece.size;
+
+				// Unless the region ends here, keep instructions clear of
+				// the end of what was read
+				const bool last = cursor.pos + piece.size >= region_end;
+				const size_t end = last || piece.failed ?
+				                   piece.size : piece.size - max_length;
+
+				size_t decoded_end = 0;
+
+				total += image_sweep(arch, section, end,
+				                     [&](const Image_batch& batch)
+				{
+					decoded_end = batch.offset[batch.count - 1] +
+					              batch.length[batch.count - 1];
+					visit(batch);
+				});
+
+				// Move on even if nothing was decoded, or the region
+				// would be read again and again
+				if (last)
+					cursor.pos = region_end;
+				else
+					cursor.pos += decoded_end != 0 ? decoded_end : end;
+			}
+
+			if (piece.failed)
+				cursor.pos = region_end;
+		}
+
+		while (next < cursors.size() &&
+		       cursors[next].pos >= cursors[next].region->end)
+		{
+			++next;
+		}
+	}
+
+	return total;
+}
+
+#else
+
+bool Process_memory::open(int)
+{
+	return false;
+}
+
+size_t Process_memory::read(uint64_t, uint8_t*, size_t) const
+{
+	return 0;
+}
+
+size_t Process_memory::sweep(Arch, const std::function<void(const Image_batch&)>&)
+{
+	return 0;
+}
+
+#endif
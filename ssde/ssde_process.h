@@ -0,0 +1,103 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_PROCESS_H
+#define SSDE_PROCESS_H
+
+#include "ssde_image.h"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// Code of a running process, read with process_vm_readv. Linux only;
+// elsewhere open() always fails.
+
+namespace ssde
+{
+
+// Executable mapping of a process, [start, end)
+struct Process_region
+{
+	std::uint64_t start = 0;
+	std::uint64_t end   = 0;
+	std::string path; // file or [vdso]-like name, empty if anonymous
+};
+
+class Process_memory
+{
+public:
+	// Memory is read buffer_size bytes at a time
+	explicit Process_memory(std::size_t buffer_size = 4 << 20);
+
+	// Lists the executable mappings of pid and finds which decoder its
+	// executable needs. Returns false if the maps can't be read. Reading
+	// memory needs the same permissions as ptrace.
+	bool open(int pid);
+
+	// Decoder for the process's executable, unknown if it couldn't be read
+	Arch arch() const
+	{
+		return arch_;
+	}
+
+	const std::vector<Process_region>& regions() const
+	{
+		return regions_;
+	}
+
+	// Reads up to size bytes at address, returns how many were read
+	std::size_t read(std::uint64_t address, std::uint8_t* out,
+	                 std::size_t size) const;
+
+	// Linear sweep over every executable region with the decoder for
+	// arch. Regions are read a buffer at a time, several small ones with
+	// one call. Instructions are handed to visit as by image_sweep, with
+	// section pointing at the bytes read and address set to where they
+	// are in the process. A read stops short of an instruction that would
+	// cross the end of the buffer; that instruction starts the next read,
+	// so the result is the same as sweeping each region in one piece.
+	//
+	// Regions that go away while being read are skipped from there on.
+	// Returns the number of instructions decoded, 0 if arch is neither x86
+	// nor x64.
+	std::size_t sweep(Arch arch,
+	                  const std::function<void(const Image_batch&)>& visit);
+
+	// Bytes read by sweep so far
+	std::uint64_t bytes_read() const
+	{
+		return bytes_read_;
+	}
+
+private:
+	int pid = 0;
+	Arch arch_ = Arch::unknown;
+	std::vector<Process_region> regions_;
+
+	std::vector<std::uint8_t> buffer;
+	std::uint64_t bytes_read_ = 0;
+};
+
+} // namespace ssde
+
+#endif // SSDE_PROCESS_H
@@ -0,0 +1,95 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_READER_H
+#define SSDE_READER_H
+
+#include <cstdint>
+#include <cstddef>
+
+
+// Bounds checked reads of file headers, shared by the image readers
+// (ssde_elf.cpp, ssde_pe.cpp, ssde_cortex_m.cpp). Not a part of the public
+// interface.
+
+namespace ssde
+{
+namespace detail
+{
+
+// Little endian reader. Reads that would go out of bounds read zeros, so
+// that headers can be read first and checked after.
+class Reader
+{
+public:
+	Reader(const std::uint8_t* data, std::size_t size)
+		: data(data), size(size)
+	{
+	}
+
+	std::uint64_t read(std::uint64_t pos, std::size_t bytes) const
+	{
+		if (!contains(pos, bytes))
+			return 0;
+
+		std::uint64_t value = 0;
+
+		for (std::size_t i = bytes; i-- > 0; )
+			value = value << 8 | data[pos + i];
+
+		return value;
+	}
+
+	std::uint16_t u16(std::uint64_t pos) const
+	{
+		return static_cast<std::uint16_t>(read(pos, 2));
+	}
+
+	std::uint32_t u32(std::uint64_t pos) const
+	{
+		return static_cast<std::uint32_t>(read(pos, 4));
+	}
+
+	std::uint64_t u64(std::uint64_t pos) const
+	{
+		return read(pos, 8);
+	}
+
+	bool contains(std::uint64_t pos, std::uint64_t bytes) const
+	{
+		return pos <= size && bytes <= size - pos;
+	}
+
+	// count entries of stride bytes each, without multiplying them out
+	bool contains(std::uint64_t pos, std::uint64_t count,
+	              std::uint64_t stride) const
+	{
+		return pos <= size && (count == 0 || (stride != 0 &&
+		       count <= (size - pos) / stride));
+	}
+
+	const std::uint8_t* data;
+	std::size_t size;
+};
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_READER_H
@@ -0,0 +1,220 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Incremental disassembly for X86 and X64
+#include "ssde_region.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include "ssde_x86_length.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+using ssde::Region_core;
+using ssde::Region_change;
+using ssde::Region_inst;
+using ssde::Mode_x86;
+using ssde::Mode_x64;
+using ssde::Length_x86;
+using ssde::Length_x64;
+using ssde::detail::Prefix_run;
+using ssde::detail::scan_prefixes_scalar;
+using ssde::detail::decode_length;
+using std::size_t;
+using std::uint8_t;
+using std::uint64_t;
+
+
+namespace
+{
+
+// Decoding an instruction looks at no more than this many bytes, so a patch
+// can't change instructions starting further back
+const size_t max_length = 15;
+
+template <typename Mode>
+struct Length_of;
+
+template <>
+struct Length_of<Mode_x86>
+{
+	using type = Length_x86;
+};
+
+template <>
+struct Length_of<Mode_x64>
+{
+	using type = Length_x64;
+};
+
+inline size_t first_set(uint64_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return index;
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+} // namespace
+
+
+template <typename Mode>
+Region_core<Mode>::Region_core(const uint8_t* buffer, size_t size)
+	: bytes(buffer, buffer + size), starts((size + 63) / 64), lengths(size)
+{
+	for (size_t pos = 0; pos < size; )
+	{
+		uint8_t length = decode(pos);
+
+		starts[pos / 64] |= uint64_t(1) << (pos % 64);
+		lengths[pos] = length;
+		count_++;
+
+		pos += length;
+	}
+}
+
+template <typename Mode>
+uint8_t Region_core<Mode>::decode(size_t pos) const
+{
+	using Length = typename Length_of<Mode>::type;
+
+	Prefix_run run = scan_prefixes_scalar<Mode>(bytes.data(), size(), pos);
+	Length len = decode_length<Mode, Length>(bytes.data(), size(), pos, run);
+
+	return static_cast<uint8_t>(len.length);
+}
+
+template <typename Mode>
+size_t Region_core<Mode>::next_start(size_t pos) const
+{
+	if (pos >= size())
+		return size();
+
+	size_t word = pos / 64;
+	uint64_t mask = starts[word] & (~uint64_t(0) << (pos % 64));
+
+	while (mask == 0)
+	{
+		if (++word == starts.size())
+			return size();
+
+		mask = starts[word];
+	}
+
+	return word * 64 + first_set(mask);
+}
+
+template <typename Mode>
+Region_change Region_core<Mode>::patch(size_t offset, const uint8_t* patch,
+                                       size_t patch_size)
+{
+	Region_change change;
+
+	if (offset >= size() || patch_size == 0)
+		return change;
+
+	const size_t end = std::min(offset + patch_size, size());
+
+	std::copy(patch, patch + (end - offset), bytes.begin() + offset);
+
+	// Instructions starting far enough back never looked at the patched
+	// bytes. The one containing offset starts within max_length - 1 bytes
+	// of it, so begin is never past offset.
+	const size_t begin = next_start(offset >= max_length - 1 ?
+	                                offset - (max_length - 1) : 0);
+
+	// Decode until a new instruction starts where an old one did, past the
+	// patch. From there on nothing changed.
+	size_t pos = begin;
+
+	while (pos < size() && !(pos >= end && is_start(pos)))
+	{
+		change.added.push_back(Region_inst{pos, decode(pos)});
+		pos += change.added.back().length;
+	}
+
+	const size_t sync = std::min(pos, size());
+
+	for (size_t old = begin; old < sync; old = next_start(old + 1))
+		change.removed.push_back(Region_inst{old, lengths[old]});
+
+	// Swap boundaries in [begin, sync)
+	for (const Region_inst& inst : change.removed)
+		starts[inst.pos / 64] &= ~(uint64_t(1) << (inst.pos % 64));
+
+	for (const Region_inst& inst : change.added)
+	{
+		starts[inst.pos / 64] |= uint64_t(1) << (inst.pos % 64);
+		lengths[inst.pos] = inst.length;
+	}
+
+	count_ += change.added.size();
+	count_ -= change.removed.size();
+
+	// Leave out instructions that are still there as they were
+	auto same = [offset, end](const Region_inst& a, const Region_inst& b)
+	{
+		return a.pos == b.pos && a.length == b.length &&
+		       (a.pos + a.length <= offset || a.pos >= end);
+	};
+
+	auto removed = change.removed.begin();
+	auto added = change.added.begin();
+	auto removed_out = removed;
+	auto added_out = added;
+
+	while (removed != change.removed.end() || added != change.added.end())
+	{
+		if (removed != change.removed.end() && added != change.added.end() &&
+		    same(*removed, *added))
+		{
+			++removed;
+			++added;
+		}
+		else if (added == change.added.end() ||
+		         (removed != change.removed.end() && removed->pos <= added->pos))
+		{
+			*removed_out++ = *removed++;
+		}
+		else
+		{
+			*added_out++ = *added++;
+		}
+	}
+
+	change.removed.erase(removed_out, change.removed.end());
+	change.added.erase(added_out, change.added.end());
+
+	return change;
+}
+
+template class ssde::Region_core<Mode_x86>;
+template class ssde::Region_core<Mode_x64>;
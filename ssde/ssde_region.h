@@ -0,0 +1,120 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_REGION_H
+#define SSDE_REGION_H
+
+#include "ssde_x86_core.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Incremental disassembly of code that changes, such as JIT output and
+// self-patching code.
+
+namespace ssde
+{
+
+struct Region_inst
+{
+	std::size_t  pos;
+	std::uint8_t length;
+};
+
+// Instructions a patch removed from and added to a region, in order of
+// address. Instructions that start and end in the same place as before and
+// don't overlap the patched bytes are left out of both.
+struct Region_change
+{
+	std::vector<Region_inst> removed;
+	std::vector<Region_inst> added;
+};
+
+// Own copy of a region of code and the instruction boundaries of a linear
+// sweep over it. After a patch, only the instructions from shortly before
+// the patch up to where the new boundaries line up with the old ones again
+// are decoded, so the cost of a patch depends on its size, not the size of
+// the region.
+template <typename Mode>
+class Region_core
+{
+public:
+	Region_core(const std::uint8_t* buffer, std::size_t size);
+
+	// Writes count bytes at offset and redecodes what they affect. Bytes
+	// past the end of the region are dropped.
+	Region_change patch(std::size_t offset, const std::uint8_t* bytes,
+	                    std::size_t count);
+
+	const std::uint8_t* data() const
+	{
+		return bytes.data();
+	}
+
+	std::size_t size() const
+	{
+		return bytes.size();
+	}
+
+	// Number of instructions
+	std::size_t count() const
+	{
+		return count_;
+	}
+
+	bool is_start(std::size_t pos) const
+	{
+		return pos < size() && (starts[pos / 64] >> (pos % 64) & 1);
+	}
+
+	// Length of the instruction starting at pos, if is_start(pos)
+	std::uint8_t length(std::size_t pos) const
+	{
+		return lengths[pos];
+	}
+
+	// First instruction starting at or after pos, size() if there is none
+	std::size_t next_start(std::size_t pos) const;
+
+private:
+	std::uint8_t decode(std::size_t pos) const;
+
+	std::vector<std::uint8_t>  bytes;
+	std::vector<std::uint64_t> starts;  // bit per byte
+	std::vector<std::uint8_t>  lengths; // valid at starts
+	std::size_t count_ = 0;
+};
+
+class Region_x86 : public Region_core<Mode_x86>
+{
+public:
+	using Region_core<Mode_x86>::Region_core;
+};
+
+class Region_x64 : public Region_core<Mode_x64>
+{
+public:
+	using Region_core<Mode_x64>::Region_core;
+};
+
+} // namespace ssde
+
+#endif // SSDE_REGION_H
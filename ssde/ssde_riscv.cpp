@@ -0,0 +1,377 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// SSDE implementation for RISC-V
+#include "ssde_riscv.h"
+#include "ssde_riscv_tables.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+using ssde::Inst_RISCV;
+using ssde::Range_riscv;
+using ssde::Flow;
+namespace riscv = ssde::detail::riscv;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::int32_t;
+using std::int64_t;
+
+
+namespace
+{
+
+const uint8_t error_eof       = static_cast<uint8_t>(Inst_RISCV::Error::eof);
+const uint8_t error_alignment = static_cast<uint8_t>(Inst_RISCV::Error::alignment);
+const uint8_t error_opcode    = static_cast<uint8_t>(Inst_RISCV::Error::opcode);
+const uint8_t error_length    = static_cast<uint8_t>(Inst_RISCV::Error::length);
+
+const uint8_t no_reg = Inst_RISCV::no_reg;
+
+struct Decoded
+{
+	uint8_t length = 2;
+	uint8_t error = 0;
+	Flow flow = Flow::none;
+	bool has_rel = false;
+	bool is_ecall = false;
+	uint8_t rd = no_reg;
+	uint8_t rs1 = no_reg;
+	int32_t rel = 0;
+	uint32_t opcode = 0;
+};
+
+inline uint32_t fetch16(const uint8_t* buffer, size_t pos)
+{
+	return buffer[pos] | static_cast<uint32_t>(buffer[pos + 1]) << 8;
+}
+
+// Sign extends the low bits bits of value
+inline int32_t sign_extend(uint32_t value, int bits)
+{
+	return static_cast<int32_t>(value << (32 - bits)) >> (32 - bits);
+}
+
+// Class table index of the instruction starting with halfword hw
+inline uint32_t class_index(uint32_t hw)
+{
+	return (hw & 3) == 3 ? 32 | (hw >> 2 & 31) : (hw >> 13) << 2 | (hw & 3);
+}
+
+// x1 (ra) and x5 (t0) are the link registers
+inline bool is_link(uint32_t reg)
+{
+	return reg == 1 || reg == 5;
+}
+
+// Flow of a jump through a register, by the hints in its rd and rs1
+inline Flow jump_flow(uint32_t rd, uint32_t rs1)
+{
+	if (rd != 0)
+		return Flow::call;
+
+	return is_link(rs1) ? Flow::ret : Flow::jump;
+}
+
+void decode_compressed(uint32_t hw, Inst_RISCV::Xlen xlen, Decoded& d)
+{
+	switch (riscv::table[class_index(hw)])
+	{
+	case riscv::c_zero:
+		if (hw == 0)
+		{
+			d.flow = Flow::stop;
+			d.error |= error_opcode;
+		}
+		break;
+
+	case riscv::c_jal:
+		if (xlen != Inst_RISCV::Xlen::rv32)
+			break;
+		d.rd = 1;
+		// fall through
+
+	case riscv::c_j:
+		if (d.rd == no_reg)
+			d.rd = 0;
+
+		d.flow = d.rd != 0 ? Flow::call : Flow::jump;
+		d.has_rel = true;
+		d.rel = sign_extend((hw >> 1 & 0x800) | (hw >> 7 & 0x010) |
+		                    (hw >> 1 & 0x300) | (hw << 2 & 0x400) |
+		                    (hw >> 1 & 0x040) | (hw << 1 & 0x080) |
+		                    (hw >> 2 & 0x00e) | (hw << 3 & 0x020), 12);
+		break;
+
+	case riscv::c_b:
+		d.flow = Flow::branch;
+		d.has_rel = true;
+		d.rs1 = static_cast<uint8_t>(8 + (hw >> 7 & 7));
+		d.rel = sign_extend((hw >> 4 & 0x100) | (hw >> 7 & 0x018) |
+		                    (hw << 1 & 0x0c0) | (hw >> 2 & 0x006) |
+		                    (hw << 3 & 0x020), 9);
+		break;
+
+	case riscv::c_jr:
+	{
+		const uint32_t rs1 = hw >> 7 & 31;
+
+		// C.MV and C.ADD have rs2, C.JR, C.JALR and C.EBREAK don't
+		if (hw >> 2 & 31)
+			break;
+
+		if (rs1 == 0)
+		{
+			d.flow = Flow::stop;
+
+			if (!(hw & 0x1000)) // reserved
+				d.error |= error_opcode;
+			break;
+		}
+
+		d.rd = (hw & 0x1000) ? 1 : 0;
+		d.rs1 = static_cast<uint8_t>(rs1);
+		d.flow = jump_flow(d.rd, rs1);
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+void decode_word(uint32_t w, Decoded& d)
+{
+	const uint32_t rd = w >> 7 & 31;
+	const uint32_t rs1 = w >> 15 & 31;
+	const uint32_t funct3 = w >> 12 & 7;
+
+	switch (riscv::table[class_index(w & 0xffff)])
+	{
+	case riscv::auipc:
+		d.has_rel = true;
+		d.rd = static_cast<uint8_t>(rd);
+		d.rel = static_cast<int32_t>(w & 0xfffff000);
+		break;
+
+	case riscv::branch:
+		if (funct3 == 2 || funct3 == 3)
+		{
+			d.flow = Flow::stop;
+			d.error |= error_opcode;
+			break;
+		}
+
+		d.flow = Flow::branch;
+		d.has_rel = true;
+		d.rs1 = static_cast<uint8_t>(rs1);
+		d.rel = sign_extend((w >> 19 & 0x1000) | (w >> 20 & 0x07e0) |
+		                    (w >> 7 & 0x001e) | (w << 4 & 0x0800), 13);
+		break;
+
+	case riscv::jalr:
+		if (funct3 != 0)
+		{
+			d.flow = Flow::stop;
+			d.error |= error_opcode;
+			break;
+		}
+
+		d.rd = static_cast<uint8_t>(rd);
+		d.rs1 = static_cast<uint8_t>(rs1);
+		d.flow = jump_flow(rd, rs1);
+		break;
+
+	case riscv::jal:
+		d.flow = rd != 0 ? Flow::call : Flow::jump;
+		d.has_rel = true;
+		d.rd = static_cast<uint8_t>(rd);
+		d.rel = sign_extend((w >> 11 & 0x100000) | (w >> 20 & 0x0007fe) |
+		                    (w >> 9 & 0x000800) | (w & 0x0ff000), 21);
+		break;
+
+	case riscv::system:
+		switch (w)
+		{
+		case 0x00000073: // ECALL
+			d.is_ecall = true;
+			break;
+
+		case 0x00100073: // EBREAK
+			d.flow = Flow::stop;
+			break;
+
+		case 0x30200073: // MRET
+		case 0x10200073: // SRET
+		case 0x7b200073: // DRET
+			d.flow = Flow::ret;
+			break;
+
+		default:
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Decodes the instruction at pos
+inline Decoded decode(const uint8_t* buffer, size_t size, size_t pos,
+                      Inst_RISCV::Xlen xlen)
+{
+	Decoded d;
+
+	if (pos % 2 != 0)
+		d.error |= error_alignment;
+
+	if (pos > size || size - pos < 2)
+	{
+		d.flow = Flow::stop;
+		d.error |= error_eof;
+		return d;
+	}
+
+	const uint32_t hw = fetch16(buffer, pos);
+
+	if ((hw & 3) != 3)
+	{
+		d.opcode = hw;
+		decode_compressed(hw, xlen, d);
+		return d;
+	}
+
+	switch (riscv::table[class_index(hw)])
+	{
+	case riscv::w48:
+		d.length = 6;
+		d.flow = Flow::stop;
+		d.error |= error_opcode;
+		break;
+
+	case riscv::w64:
+		d.length = 8;
+		d.flow = Flow::stop;
+		d.error |= error_opcode;
+		break;
+
+	case riscv::w80:
+		d.flow = Flow::stop;
+		d.error |= error_length;
+		return d;
+
+	default:
+		d.length = 4;
+		break;
+	}
+
+	if (size - pos < d.length)
+	{
+		d.flow = Flow::stop;
+		d.error |= error_eof;
+		return d;
+	}
+
+	d.opcode = hw | fetch16(buffer, pos + 2) << 16;
+
+	if (d.length == 4)
+		decode_word(d.opcode, d);
+
+	return d;
+}
+
+} // namespace
+
+
+Inst_RISCV::Inst_RISCV(const uint8_t* buffer, size_t size, size_t pos,
+                       Xlen xlen)
+{
+	const Decoded d = decode(buffer, size, pos, xlen);
+
+	length   = d.length;
+	opcode   = d.opcode;
+	flow     = d.flow;
+	has_rel  = d.has_rel;
+	rel      = d.rel;
+	rd       = d.rd;
+	rs1      = d.rs1;
+	is_ecall = d.is_ecall;
+
+	error_flags = d.error;
+}
+
+size_t ssde::riscv_decode_range(const uint8_t* buffer, size_t size,
+                                size_t start, size_t end,
+                                const Range_riscv& out, Inst_RISCV::Xlen xlen)
+{
+	if (end > size)
+		end = size;
+
+	size_t pos = start;
+	size_t count = 0;
+
+	// Misaligned code takes the slow path throughout
+	const bool aligned = pos % 2 == 0;
+
+	while (pos < end && count < out.capacity)
+	{
+		out.offset[count] = pos;
+
+		// Instructions that can't change flow only need their length
+		if (aligned && size - pos >= 4)
+		{
+			const uint32_t hw = fetch16(buffer, pos);
+
+			if (riscv::table[class_index(hw)] == riscv::no)
+			{
+				const uint8_t length = (hw & 3) == 3 ? 4 : 2;
+
+				out.length[count]  = length;
+				out.target[count]  = static_cast<int64_t>(pos);
+				out.has_rel[count] = 0;
+				out.flow[count]    = Flow::none;
+				out.error[count]   = 0;
+
+				pos += length;
+				++count;
+				continue;
+			}
+		}
+
+		const Decoded d = decode(buffer, size, pos, xlen);
+
+		out.length[count]  = d.length;
+		out.target[count]  = static_cast<int64_t>(pos) + d.rel;
+		out.has_rel[count] = d.has_rel;
+		out.flow[count]    = d.flow;
+		out.error[count]   = d.error;
+
+		pos += d.length;
+		++count;
+	}
+
+	return count;
+}
+
+constexpr std::uint8_t Inst_RISCV::no_reg;
@@ -0,0 +1,140 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_RISCV_H
+#define SSDE_RISCV_H
+
+#include "ssde_cfg.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// With the C extension instructions are 2 or 4 bytes long and aligned to 2.
+// Like Inst_ARM, a misaligned pos signals Error::alignment, but the
+// instruction there is still decoded.
+
+namespace ssde
+{
+
+// RISC-V instruction of RV32GC or RV64GC. Only what matters for following
+// control flow is extracted: length, how the instruction passes control on
+// and the target of PC relative jumps, branches and AUIPC.
+class Inst_RISCV
+{
+public:
+	enum class Error : std::uint8_t
+	{
+		eof       = 1 << 0, // Reached end of buffer before finished decoding
+		alignment = 1 << 1, // PC is misaligned
+		opcode    = 1 << 2, // Illegal instruction, or one longer than 32 bit
+		length    = 1 << 3, // Instruction is 80 bit or longer
+	};
+
+	enum class Xlen
+	{
+		rv32 = 0,
+		rv64 = 1,
+	};
+
+	static constexpr std::uint8_t no_reg = 0xff;
+
+
+	Inst_RISCV()
+	{
+	}
+
+	Inst_RISCV(const std::uint8_t* buffer, std::size_t size,
+	           std::size_t in_pos = 0, Xlen xlen = Xlen::rv64);
+
+	Inst_RISCV(const std::vector<std::uint8_t>& buffer,
+	           std::size_t in_pos = 0, Xlen xlen = Xlen::rv64) :
+		Inst_RISCV(buffer.data(), buffer.size(), in_pos, xlen)
+	{
+	}
+
+	bool has_error(Error signal) const
+	{
+		return (error_flags & static_cast<std::uint8_t>(signal)) ? true : false;
+	}
+
+	bool has_error() const
+	{
+		return error_flags != 0;
+	}
+
+
+	// 2 or 4. Instructions outside of GC have their encoded length, 6 or 8,
+	// and signal Error::opcode. 80 bit and longer ones signal Error::length
+	// and are stepped over 2 bytes at a time.
+	std::int32_t length = 0;
+
+	std::uint32_t opcode = 0; // instruction as read, 16 bit ones zero extended
+
+	// Branches are Flow::branch. JAL and JALR are jumps with x0 as rd,
+	// returns if JALR jumps to ra or t0 (x1, x5), calls otherwise; same for
+	// C.J, C.JAL, C.JR, C.JALR. MRET, SRET and DRET are returns, EBREAK and
+	// illegal instructions Flow::stop.
+	Flow flow = Flow::none;
+
+	// Set for JAL, branches, C.J, C.JAL, C.BEQZ, C.BNEZ, which transfer
+	// control to pos + rel, and AUIPC, which puts pos + rel in rd (flow is
+	// none).
+	bool has_rel = false;
+	// abs = pos + rel
+	std::int32_t rel = 0;
+
+	// Registers of jumps, branches and AUIPC, no_reg for anything else
+	std::uint8_t rd  = no_reg;
+	std::uint8_t rs1 = no_reg;
+
+	bool is_ecall = false;
+
+protected:
+	std::uint8_t error_flags = 0;
+};
+
+
+// Struct-of-arrays output of riscv_decode_range, in the manner of Range_x64.
+// Arrays are owned by the caller and must have room for capacity entries.
+struct Range_riscv
+{
+	std::size_t*  offset  = nullptr; // where instruction starts
+	std::uint8_t* length  = nullptr;
+	std::int64_t* target  = nullptr; // offset + rel, valid if has_rel is set
+	std::uint8_t* has_rel = nullptr;
+	Flow*         flow    = nullptr;
+	std::uint8_t* error   = nullptr; // Inst_RISCV::Error flags
+	std::size_t   capacity = 0;
+};
+
+// Linear sweep over [start, end) of buffer, with the same result as decoding
+// Inst_RISCVs one after another. Only the length is worked out for
+// instructions that can't change flow, which is most of them. Returns how
+// many instructions were written. The last one may extend past end; if it
+// runs past size, it signals Error::eof.
+std::size_t riscv_decode_range(const std::uint8_t* buffer, std::size_t size,
+                               std::size_t start, std::size_t end,
+                               const Range_riscv& out,
+                               Inst_RISCV::Xlen xlen = Inst_RISCV::Xlen::rv64);
+
+} // namespace ssde
+
+#endif // SSDE_RISCV_H
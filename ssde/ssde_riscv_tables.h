@@ -0,0 +1,73 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_RISCV_TABLES_H
+#define SSDE_RISCV_TABLES_H
+
+#include <cstdint>
+
+
+// Class table of the RISC-V decoder. A compressed instruction is classified
+// by funct3 and its quadrant (bits 15..13 and 1..0), anything longer by the
+// major opcode (bits 6..2), in the second half of the table.
+
+namespace ssde
+{
+namespace detail
+{
+
+namespace riscv
+{
+
+enum Class : std::uint8_t
+{
+	no,     // can't change flow or form an address
+	c_zero, // C.ADDI4SPN, illegal if all zeroes
+	c_jal,  // C.JAL on RV32, C.ADDIW on RV64
+	c_j,    // C.J
+	c_b,    // C.BEQZ, C.BNEZ
+	c_jr,   // C.JR, C.JALR, C.EBREAK, C.MV, C.ADD
+	auipc,  // AUIPC
+	branch, // BEQ, BNE, BLT, BGE, BLTU, BGEU
+	jalr,   // JALR
+	jal,    // JAL
+	system, // ECALL, EBREAK, MRET, SRET, CSR access
+	w48,    // 48 bit instruction
+	w64,    // 64 bit instruction
+	w80,    // 80 bit or longer
+};
+
+// [funct3 << 2 | quadrant] for compressed instructions (quadrant 3 is unused)
+// [32 + bits 6..2] for the rest
+static constexpr std::uint8_t table[64] =
+{
+	//x0    |  x1   |  x2   |  x3   |  x4   |  x5   |  x6   |  x7   |  x8   |  x9   |  xA   |  xB   |  xC   |  xD   |  xE   |  xF
+	 c_zero ,  no   ,  no   ,  no   ,  no   , c_jal ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   , // 00..0F
+	  no    ,  no   , c_jr  ,  no   ,  no   ,  c_j  ,  no   ,  no   ,  no   ,  c_b  ,  no   ,  no   ,  no   ,  c_b  ,  no   ,  no   , // 10..1F
+	  no    ,  no   ,  no   ,  no   ,  no   , auipc ,  no   ,  w48  ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  w64  , // 20..2F
+	  no    ,  no   ,  no   ,  no   ,  no   ,  no   ,  no   ,  w48  , branch, jalr  ,  no   ,  jal  , system,  no   ,  no   ,  w80  , // 30..3F
+};
+
+} // namespace riscv
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_RISCV_TABLES_H
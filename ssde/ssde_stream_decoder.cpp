@@ -0,0 +1,137 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Decoding of chunked input for X86 and X64
+#include "ssde_stream_decoder.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+
+using ssde::Stream_decoder_core;
+using ssde::Inst_x86;
+using ssde::Inst_x64;
+using std::size_t;
+using std::uint8_t;
+
+
+namespace
+{
+
+// Longest instruction. The decoder reads zeros past the end of its buffer,
+// which wouldn't always be what follows in the stream, and only tells that
+// an instruction is too long once it reads byte 16. So instructions are only
+// decoded with view bytes in view.
+const size_t max_length = 15;
+const size_t view = max_length + 1;
+
+} // namespace
+
+
+template <typename Inst>
+size_t Stream_decoder_core<Inst>::feed(const uint8_t* chunk, size_t size,
+                                       const Visit& visit)
+{
+	size_t count = 0;
+	size_t pos = 0;
+
+	// Finish the carried instruction with the first bytes of the chunk
+	while (carry_size != 0)
+	{
+		if (carry_size + size < view)
+		{
+			std::memcpy(carry + carry_size, chunk, size);
+			carry_size += size;
+			return count;
+		}
+
+		uint8_t joined[max_carry + view];
+		const size_t taken = std::min(size, view);
+
+		std::memcpy(joined, carry, carry_size);
+		std::memcpy(joined + carry_size, chunk, taken);
+
+		const Inst inst{joined, carry_size + taken};
+		const size_t length = static_cast<size_t>(inst.length);
+
+		visit(inst, offset);
+		count++;
+
+		offset += length;
+
+		if (length >= carry_size)
+		{
+			pos = length - carry_size;
+			carry_size = 0;
+		}
+		else
+		{
+			std::memmove(carry, carry + length, carry_size - length);
+			carry_size -= length;
+		}
+	}
+
+	for (; pos + max_length < size; ++count)
+	{
+		const Inst inst{chunk, size, pos};
+
+		visit(inst, offset);
+
+		offset += static_cast<size_t>(inst.length);
+		pos += static_cast<size_t>(inst.length);
+	}
+
+	std::memcpy(carry, chunk + pos, size - pos);
+	carry_size = size - pos;
+
+	return count;
+}
+
+template <typename Inst>
+size_t Stream_decoder_core<Inst>::finish(const Visit& visit)
+{
+	size_t count = 0;
+	size_t pos = 0;
+
+	while (pos < carry_size)
+	{
+		const Inst inst{carry, carry_size, pos};
+
+		visit(inst, offset);
+		count++;
+
+		offset += static_cast<size_t>(inst.length);
+		pos += static_cast<size_t>(inst.length);
+	}
+
+	carry_size = 0;
+
+	return count;
+}
+
+template <typename Inst>
+constexpr size_t Stream_decoder_core<Inst>::max_carry;
+
+template class ssde::Stream_decoder_core<Inst_x86>;
+template class ssde::Stream_decoder_core<Inst_x64>;
@@ -0,0 +1,104 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_STREAM_DECODER_H
+#define SSDE_STREAM_DECODER_H
+
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+
+namespace ssde
+{
+
+// Decoder for code that arrives in chunks, such as from a pipe or a
+// decompressor. Instructions are decoded in place in each chunk, except for
+// the last 15 bytes, which are carried over and decoded with the start of
+// the next one. Memory use doesn't depend on the length of the stream.
+//
+// Every instruction is decoded with at least 16 bytes in view (unless the
+// stream ends first), which is exactly as Inst would decode it in the whole
+// stream at once.
+template <typename Inst>
+class Stream_decoder_core
+{
+public:
+	// inst and where it starts in the stream
+	using Visit = std::function<void(const Inst& inst, std::uint64_t offset)>;
+
+	static constexpr std::size_t max_carry = 15;
+
+	Stream_decoder_core()
+	{
+	}
+
+	// Decodes the instructions of the stream that can be decoded so far,
+	// starting with the bytes carried over from the chunk before. Returns
+	// how many were passed to visit.
+	std::size_t feed(const std::uint8_t* chunk, std::size_t size,
+	                 const Visit& visit);
+
+	// Ends the stream. Bytes still carried over are decoded as they are,
+	// with Error::eof set, same as at the end of a buffer.
+	std::size_t finish(const Visit& visit);
+
+	// Starts a new stream at offset 0
+	void reset()
+	{
+		carry_size = 0;
+		offset = 0;
+	}
+
+	// Bytes waiting for the next chunk, never more than max_carry
+	std::size_t carried() const
+	{
+		return carry_size;
+	}
+
+	// Stream offset of the first byte not yet decoded
+	std::uint64_t position() const
+	{
+		return offset;
+	}
+
+private:
+	std::uint8_t carry[max_carry];
+	std::size_t carry_size = 0;
+	std::uint64_t offset = 0;
+};
+
+class Stream_decoder_x86 : public Stream_decoder_core<Inst_x86>
+{
+public:
+	using Stream_decoder_core<Inst_x86>::Stream_decoder_core;
+};
+
+class Stream_decoder_x64 : public Stream_decoder_core<Inst_x64>
+{
+public:
+	using Stream_decoder_core<Inst_x64>::Stream_decoder_core;
+};
+
+} // namespace ssde
+
+#endif // SSDE_STREAM_DECODER_H
@@ -0,0 +1,183 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Superset disassembly for X86 and X64
+#include "ssde_superset.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include "ssde_x86_length.h"
+#include "ssde_x86_tables.h"
+#include "ssde_parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+
+using ssde::Superset;
+using ssde::Boundary_graph;
+using ssde::Mode_x86;
+using ssde::Mode_x64;
+using ssde::Length_x86;
+using ssde::Length_x64;
+using ssde::detail::Prefix_run;
+using ssde::detail::scan_prefixes_scalar;
+using ssde::detail::extend_prefixes;
+using ssde::detail::decode_length;
+using ssde::detail::default_threads;
+using ssde::detail::parallel_for;
+using std::vector;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+
+namespace prefix_class = ssde::detail::prefix_class;
+
+
+namespace
+{
+
+const size_t chunk_size = 64 * 1024;
+
+// Decodes entries [first, last) of out, back to front
+template <typename Mode, typename Length>
+void decode_chunk(const uint8_t* buffer, size_t size,
+                  size_t first, size_t last, Superset& out)
+{
+	const size_t start = out.start;
+
+	Prefix_run run = scan_prefixes_scalar<Mode>(buffer, size, start + last);
+
+	for (size_t i = last; i-- > first; )
+	{
+		const size_t pos = start + i;
+
+		Length inst;
+
+		// Most bytes aren't prefixes. Decoding those with a constant empty
+		// run lets the compiler drop prefix handling from that copy of the
+		// decoder.
+		if (prefix_class::table[Mode::long_mode][buffer[pos]] ==
+		    prefix_class::no)
+		{
+			run = Prefix_run{};
+			inst = decode_length<Mode, Length>(buffer, size, pos, Prefix_run{});
+		}
+		else
+		{
+			run = extend_prefixes<Mode>(buffer, size, pos, run);
+			inst = decode_length<Mode, Length>(buffer, size, pos, run);
+		}
+
+		out.length[i]  = static_cast<uint8_t>(inst.length);
+		out.has_rel[i] = inst.has_rel;
+		out.rel[i]     = inst.rel;
+		out.error[i]   = inst.error_flags;
+	}
+}
+
+template <typename Mode, typename Length>
+Superset decode_superset(const uint8_t* buffer, size_t size,
+                         size_t start, size_t end, unsigned threads)
+{
+	Superset out;
+
+	if (end > size)
+		end = size;
+
+	if (start >= end)
+		return out;
+
+	const size_t count = end - start;
+
+	out.start = start;
+	out.length.resize(count);
+	out.has_rel.resize(count);
+	out.rel.resize(count);
+	out.error.resize(count);
+
+	const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+	parallel_for(chunk_count, default_threads(threads), [&](size_t chunk)
+	{
+		size_t first = chunk * chunk_size;
+		size_t last  = std::min(first + chunk_size, count);
+
+		decode_chunk<Mode, Length>(buffer, size, first, last, out);
+	});
+
+	return out;
+}
+
+} // namespace
+
+
+Superset ssde::x86_decode_superset(const uint8_t* buffer, size_t size,
+                                   size_t start, size_t end, unsigned threads)
+{
+	return decode_superset<Mode_x86, Length_x86>(buffer, size, start, end,
+	                                             threads);
+}
+
+Superset ssde::x64_decode_superset(const uint8_t* buffer, size_t size,
+                                   size_t start, size_t end, unsigned threads)
+{
+	return decode_superset<Mode_x64, Length_x64>(buffer, size, start, end,
+	                                             threads);
+}
+
+Boundary_graph ssde::make_boundary_graph(const Superset& superset)
+{
+	Boundary_graph graph;
+
+	const size_t count = superset.size();
+
+	graph.next.resize(count);
+	graph.pred_begin.assign(count + 1, 0);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t next = superset.next(i);
+
+		graph.next[i] = static_cast<uint32_t>(next);
+
+		if (next < count)
+			graph.pred_begin[next + 1]++;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+		graph.pred_begin[i + 1] += graph.pred_begin[i];
+
+	graph.pred.resize(graph.pred_begin[count]);
+
+	// Predecessors come out in ascending order, since i only goes up
+	vector<uint32_t> fill(graph.pred_begin.begin(), graph.pred_begin.end() - 1);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t next = graph.next[i];
+
+		if (next < count)
+			graph.pred[fill[next]++] = static_cast<uint32_t>(i);
+	}
+
+	return graph;
+}
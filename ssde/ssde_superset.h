@@ -0,0 +1,94 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_SUPERSET_H
+#define SSDE_SUPERSET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Superset disassembly: the instruction starting at every byte of a range,
+// whether or not a linear sweep would ever get there. Meant for obfuscated
+// code and code with data in between, where the real instructions are picked
+// out of the superset afterwards.
+
+namespace ssde
+{
+
+// Instruction at every offset of [start, end). Entry i describes the
+// instruction at start + i; its length, rel and error flags are the same as
+// x86_decode_length/x64_decode_length would give there.
+struct Superset
+{
+	std::size_t size() const
+	{
+		return length.size();
+	}
+
+	// Entry the instruction at entry i falls through to. Equal to size() if
+	// it ends at or past the end of the range.
+	std::size_t next(std::size_t i) const
+	{
+		std::size_t n = i + length[i];
+		return n < size() ? n : size();
+	}
+
+
+	std::size_t start = 0;
+
+	std::vector<std::uint8_t> length;
+	std::vector<std::uint8_t> has_rel;
+	std::vector<std::int32_t> rel;   // abs = start + i + rel
+	std::vector<std::uint8_t> error; // Inst_x86::Error/Inst_x64::Error flags
+};
+
+// Decodes the superset of [start, end) of buffer on threads threads (0 picks
+// one per core). Instructions may extend past end, but never past size.
+//
+// Offsets are decoded back to front, so that the prefix run at every offset
+// is built from the one after it and each byte is classified only once.
+Superset x86_decode_superset(const std::uint8_t* buffer, std::size_t size,
+                             std::size_t start, std::size_t end,
+                             unsigned threads = 0);
+
+Superset x64_decode_superset(const std::uint8_t* buffer, std::size_t size,
+                             std::size_t start, std::size_t end,
+                             unsigned threads = 0);
+
+
+// Fall-through edges of a superset, for pruning it. Every entry has exactly
+// one successor, next[i], which is size() if the instruction leaves the
+// range. Predecessors of entry j (entries whose instruction ends right
+// before j) are pred[pred_begin[j]] to pred[pred_begin[j+1]-1].
+// Entries are 32 bit, so the range must be smaller than 4 GB.
+struct Boundary_graph
+{
+	std::vector<std::uint32_t> next;
+	std::vector<std::uint32_t> pred_begin; // size() + 1 entries
+	std::vector<std::uint32_t> pred;
+};
+
+Boundary_graph make_boundary_graph(const Superset& superset);
+
+} // namespace ssde
+
+#endif // SSDE_SUPERSET_H
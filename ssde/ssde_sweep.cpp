@@ -0,0 +1,307 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Parallel linear sweep for X86 and X64
+#include "ssde_sweep.h"
+#include "ssde_x86.h"
+#include "ssde_x64.h"
+#include "ssde_x86_length.h"
+#include "ssde_parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+
+using ssde::Sweep;
+using ssde::Mode_x86;
+using ssde::Mode_x64;
+using ssde::Length_x86;
+using ssde::Length_x64;
+using ssde::detail::scan_prefixes_scalar;
+using ssde::detail::decode_length;
+using ssde::detail::default_threads;
+using ssde::detail::parallel_for;
+using std::vector;
+using std::size_t;
+using std::uint8_t;
+using std::int32_t;
+using std::int64_t;
+
+
+namespace
+{
+
+const size_t min_chunk_size = 64 * 1024;
+const size_t chunks_per_thread = 4;
+
+// Instruction that crosses into a chunk ends at most this many bytes in
+const size_t max_overlap = 14;
+
+// Speculative paths that haven't joined the main path after this many
+// instructions are dropped and decoded again by the stitching pass
+const size_t max_lead = 64;
+
+const size_t no_join = static_cast<size_t>(-1);
+
+
+void append(Sweep& sweep, size_t pos, int32_t length, bool has_rel,
+            int32_t rel, uint8_t error_flags)
+{
+	sweep.offset.push_back(pos);
+	sweep.length.push_back(static_cast<uint8_t>(length));
+	sweep.target.push_back(static_cast<int64_t>(pos) + rel);
+	sweep.has_rel.push_back(has_rel);
+	sweep.error.push_back(error_flags);
+}
+
+struct Chunk
+{
+	size_t begin = 0;
+	size_t end   = 0;
+
+	Sweep main; // decoded from begin
+
+	// lead[i] is decoded from begin+1+i up to where it joins main, at
+	// main's instruction join[i]
+	Sweep  lead[max_overlap];
+	size_t join[max_overlap];
+
+	// What the stitching pass settled on: fix, then main from main_from
+	const Sweep* fix = nullptr;
+	Sweep  redecoded;
+	size_t main_from = 0;
+	size_t out = 0; // where the chunk goes in the result
+};
+
+// Index of the first instruction of main at or past pos
+size_t lower_bound(const Sweep& main, size_t pos)
+{
+	return std::lower_bound(main.offset.begin(), main.offset.end(), pos) -
+	       main.offset.begin();
+}
+
+// Decodes from pos until the path lands on an instruction of chunk's main
+// path, leaves the chunk or limit instructions were decoded. Returns index
+// in main the path joined at, main.size() if it left the chunk or no_join.
+template <typename Mode, typename Length>
+size_t decode_until_join(const uint8_t* buffer, size_t size,
+                         const Chunk& chunk, size_t pos, size_t limit,
+                         Sweep& out)
+{
+	const Sweep& main = chunk.main;
+	size_t j = lower_bound(main, pos);
+
+	while (pos < chunk.end)
+	{
+		while (j < main.size() && main.offset[j] < pos)
+			++j;
+
+		if (j < main.size() && main.offset[j] == pos)
+			return j;
+
+		if (out.size() == limit)
+			return no_join;
+
+		Length inst = decode_length<Mode, Length>(
+			buffer, size, pos, scan_prefixes_scalar<Mode>(buffer, size, pos));
+
+		append(out, pos, inst.length, inst.has_rel, inst.rel,
+		       inst.error_flags);
+
+		pos += inst.length;
+	}
+
+	return main.size();
+}
+
+template <typename Mode, typename Length>
+void decode_chunk(const uint8_t* buffer, size_t size, Chunk& chunk)
+{
+	Sweep& main = chunk.main;
+
+	size_t expected = (chunk.end - chunk.begin) / 3 + 1;
+	main.offset.reserve(expected);
+	main.length.reserve(expected);
+	main.target.reserve(expected);
+	main.has_rel.reserve(expected);
+	main.error.reserve(expected);
+
+	for (size_t pos = chunk.begin; pos < chunk.end; )
+	{
+		Length inst = decode_length<Mode, Length>(
+			buffer, size, pos, scan_prefixes_scalar<Mode>(buffer, size, pos));
+
+		append(main, pos, inst.length, inst.has_rel, inst.rel,
+		       inst.error_flags);
+
+		pos += inst.length;
+	}
+
+	for (size_t i = 0; i < max_overlap; ++i)
+	{
+		chunk.join[i] = no_join;
+
+		if (chunk.begin + 1 + i < chunk.end)
+		{
+			chunk.join[i] = decode_until_join<Mode, Length>(
+				buffer, size, chunk, chunk.begin + 1 + i, max_lead,
+				chunk.lead[i]);
+		}
+	}
+}
+
+template <typename T>
+void copy_column(const vector<T>& from, size_t first, size_t last,
+                 vector<T>& to, size_t at)
+{
+	std::copy(from.begin() + first, from.begin() + last, to.begin() + at);
+}
+
+void copy_rows(const Sweep& from, size_t first, size_t last,
+               Sweep& to, size_t at)
+{
+	copy_column(from.offset,  first, last, to.offset,  at);
+	copy_column(from.length,  first, last, to.length,  at);
+	copy_column(from.target,  first, last, to.target,  at);
+	copy_column(from.has_rel, first, last, to.has_rel, at);
+	copy_column(from.error,   first, last, to.error,   at);
+}
+
+template <typename Mode, typename Length>
+Sweep parallel_sweep(const uint8_t* buffer, size_t size,
+                     size_t start, size_t end, unsigned threads)
+{
+	Sweep result;
+
+	if (end > size)
+		end = size;
+
+	if (start >= end)
+		return result;
+
+	threads = default_threads(threads);
+
+	size_t chunk_count = 1;
+
+	if (threads > 1)
+	{
+		chunk_count = std::min<size_t>((end - start) / min_chunk_size,
+		                               threads * chunks_per_thread);
+		chunk_count = std::max<size_t>(chunk_count, 1);
+	}
+
+	const size_t chunk_size = (end - start) / chunk_count;
+
+	vector<Chunk> chunks(chunk_count);
+
+	for (size_t i = 0; i < chunk_count; ++i)
+	{
+		chunks[i].begin = start + i * chunk_size;
+		chunks[i].end   = i + 1 < chunk_count ? chunks[i].begin + chunk_size :
+		                                        end;
+	}
+
+	parallel_for(chunk_count, threads, [&](size_t i)
+	{
+		decode_chunk<Mode, Length>(buffer, size, chunks[i]);
+	});
+
+	// Stitch chunks together. pos is where the previous chunk's last
+	// instruction ended, which is where this chunk really starts.
+	size_t pos = start;
+	size_t total = 0;
+
+	for (Chunk& chunk : chunks)
+	{
+		const size_t overlap = pos - chunk.begin;
+
+		if (overlap == 0)
+		{
+			chunk.main_from = 0;
+		}
+		else if (overlap <= max_overlap && chunk.join[overlap-1] != no_join)
+		{
+			chunk.fix = &chunk.lead[overlap-1];
+			chunk.main_from = chunk.join[overlap-1];
+		}
+		else
+		{
+			chunk.fix = &chunk.redecoded;
+			chunk.main_from = decode_until_join<Mode, Length>(
+				buffer, size, chunk, pos, no_join, chunk.redecoded);
+		}
+
+		const Sweep& main = chunk.main;
+		const Sweep* last = chunk.main_from < main.size() ? &main : chunk.fix;
+
+		if (last && last->size() != 0)
+			pos = last->offset.back() + last->length.back();
+
+		chunk.out = total;
+		total += (chunk.fix ? chunk.fix->size() : 0) +
+		         main.size() - chunk.main_from;
+	}
+
+	if (chunk_count == 1 && !chunks[0].fix)
+		return std::move(chunks[0].main);
+
+	result.offset.resize(total);
+	result.length.resize(total);
+	result.target.resize(total);
+	result.has_rel.resize(total);
+	result.error.resize(total);
+
+	parallel_for(chunk_count, threads, [&](size_t i)
+	{
+		Chunk& chunk = chunks[i];
+		size_t at = chunk.out;
+
+		if (chunk.fix)
+		{
+			copy_rows(*chunk.fix, 0, chunk.fix->size(), result, at);
+			at += chunk.fix->size();
+		}
+
+		copy_rows(chunk.main, chunk.main_from, chunk.main.size(), result, at);
+
+		chunk = Chunk();
+	});
+
+	return result;
+}
+
+} // namespace
+
+
+Sweep ssde::x86_parallel_sweep(const uint8_t* buffer, size_t size,
+                               size_t start, size_t end, unsigned threads)
+{
+	return parallel_sweep<Mode_x86, Length_x86>(buffer, size, start, end,
+	                                            threads);
+}
+
+Sweep ssde::x64_parallel_sweep(const uint8_t* buffer, size_t size,
+                               size_t start, size_t end, unsigned threads)
+{
+	return parallel_sweep<Mode_x64, Length_x64>(buffer, size, start, end,
+	                                            threads);
+}
@@ -0,0 +1,68 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_SWEEP_H
+#define SSDE_SWEEP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace ssde
+{
+
+// Result of a parallel linear sweep. Same columns as Range_x86/Range_x64,
+// except the arrays are owned by the result.
+struct Sweep
+{
+	std::vector<std::size_t>  offset; // where instruction starts
+	std::vector<std::uint8_t> length;
+	std::vector<std::int64_t> target; // offset + rel, valid if has_rel is set
+	std::vector<std::uint8_t> has_rel;
+	std::vector<std::uint8_t> error;  // Inst_x86::Error/Inst_x64::Error flags
+
+	std::size_t size() const
+	{
+		return offset.size();
+	}
+};
+
+// Linear sweep over [start, end) of buffer, split into chunks decoded on
+// threads threads (0 picks one per core). The result is exactly what
+// x86_decode_range/x64_decode_range would produce in one go.
+//
+// Every chunk is decoded from its first byte and, speculatively, from the
+// following 14 bytes, since the instruction that crosses into a chunk ends
+// somewhere in there. X86 code resynchronizes quickly, so these paths join
+// the chunk's main path within a few instructions. Once the previous chunk
+// is known to end at some offset, the path starting there is stitched in;
+// a chunk is only decoded again if that path didn't join in time.
+Sweep x86_parallel_sweep(const std::uint8_t* buffer, std::size_t size,
+                         std::size_t start, std::size_t end,
+                         unsigned threads = 0);
+
+Sweep x64_parallel_sweep(const std::uint8_t* buffer, std::size_t size,
+                         std::size_t start, std::size_t end,
+                         unsigned threads = 0);
+
+} // namespace ssde
+
+#endif // SSDE_SWEEP_H
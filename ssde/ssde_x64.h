@@ -21,205 +21,324 @@
 #ifndef SSDE_X64_H
 #define SSDE_X64_H
 
+#include "ssde_x86_core.h"
+#include "ssde_x86_length.h"
 #include <cstdint>
 #include <cstddef>
 #include <vector>
 #include <array>
+#include <type_traits>
 
 
 namespace ssde
 {
 
-class Inst_x64
+// Instruction decoded in 64 bit mode, see Inst_x86_core
+class Inst_x64 : public Inst_x86_core<Mode_x64>
 {
 public:
-	enum class Error : std::uint8_t
-	{
-		eof     = 1 << 0, // Reached end of buffer before finished decoding
-		length  = 1 << 1, // Instruction is too long
-		opcode  = 1 << 2, // Instruction doesn't exist
-		operand = 1 << 3, // Operands don't match instruction's requirements
-		no_vex  = 1 << 4, // Instruction should've been VEX encoded
-		lock    = 1 << 5, // LOCK prefix is not allowed
-		rex     = 1 << 6, // REX prefix is not allowed
-	};
+	using Inst_x86_core<Mode_x64>::Inst_x86_core;
 
-	enum class Prefix : std::uint8_t // X86 instruction prefix
-	{
-		none             = 0x00,
-		seg_cs           = 0x2e,
-		seg_ss           = 0x36,
-		seg_ds           = 0x3e,
-		seg_es           = 0x26,
-		seg_fs           = 0x64,
-		seg_gs           = 0x65,
-		lock             = 0xf0,
-		repnz            = 0xf2,
-		repz             = 0xf3,
-		p66              = 0x66,
-		p67              = 0x67,
-		branch_taken     = 0x3e,
-		branch_not_taken = 0x2e,
-		fpu_double       = 0xf2,
-		fpu_single       = 0xf3,
-	};
+private:
+	friend class Inst_x64_packed;
+};
 
-	enum class VEX_rm : std::uint8_t // EVEX rounding mode
-	{
-		near  = 0x00,
-		floor = 0x01,
-		ceil  = 0x02,
-		trunc = 0x03,
-		none  = 0xff,
-		mxcsr = 0xff,
-	};
 
-	enum class RM_mode : std::uint8_t // Mod R/M addressing mode
-	{
-		mem        = 0x00, // [r]
-		mem_disp8  = 0x01, // [r]+disp8
-		mem_disp32 = 0x02, // [r]+disp32
-		reg        = 0x03, // r
-	};
+// Compact copy of Inst_x64 for keeping large amounts of decoded instructions
+// in memory. Fields are packed into bitfields and can be read through
+// accessors named after the fields of Inst_x64.
+class Inst_x64_packed
+{
+public:
+	using Error   = Inst_x64::Error;
+	using Prefix  = Inst_x64::Prefix;
+	using VEX_rm  = Inst_x64::VEX_rm;
+	using RM_mode = Inst_x64::RM_mode;
 
 
-	Inst_x64()
-	{
-	}
+	Inst_x64_packed() = default;
+
+	explicit Inst_x64_packed(const Inst_x64& inst);
 
-	Inst_x64(const std::vector<std::uint8_t>& buffer, std::size_t in_pos = 0) :
-		pos(in_pos)
+	Inst_x64_packed(const std::uint8_t* buffer, std::size_t size,
+	                std::size_t in_pos = 0) :
+		Inst_x64_packed(Inst_x64(buffer, size, in_pos))
 	{
-		internal_decode(buffer);
 	}
 
 	bool has_prefix(Prefix pref) const
 	{
-		return (prefixes[0] == pref || prefixes[1] == pref ||
-		        prefixes[2] == pref || prefixes[3] == pref);
+		const std::array<Prefix, 4> all = prefixes();
+
+		return all[0] == pref || all[1] == pref ||
+		       all[2] == pref || all[3] == pref;
 	}
 
 	bool has_prefix() const
 	{
-		return (prefixes[0] != Prefix::none || prefixes[1] != Prefix::none ||
-		        prefixes[2] != Prefix::none || prefixes[3] != Prefix::none);
+		return prefix_0_ != 0 || prefix_1_ != 0 ||
+		       prefix_2_ != 0 || prefix_3_ != 0;
 	}
 
 	bool has_error(Error signal) const
 	{
-		return (error_flags & static_cast<std::uint8_t>(signal)) ? true : false;
+		return (error_flags_ & static_cast<std::uint8_t>(signal)) ? true : false;
 	}
 
 	bool has_error() const
 	{
-		return error_flags != 0;
+		return error_flags_ != 0;
 	}
 
+	std::int32_t length() const { return length_; }
 
-	std::int32_t length = 0;
+	std::array<Prefix, 4> prefixes() const
+	{
+		return {{ group_0[prefix_0_], group_1[prefix_1_],
+		          prefix_2_ ? Prefix::p66 : Prefix::none,
+		          prefix_3_ ? Prefix::p67 : Prefix::none }};
+	}
 
-	// Instruction's prefixes (grouped)
-	// To check if instruction has prefix, use Inst_x64::has_prefix
-
-	// 0: LOCK, REPNZ and REPZ prefixes and/or FPU op. size modifiers
-	// 1: Segment (seg_*) prefixes and/or branch hints
-	// 2: Operand size override prefix (p66)
-	// 3: Address size override prefix (p67)
-	std::array<Prefix, 4> prefixes{ };
-
-	bool has_rex = false;
-	bool rex_W   = false;
-	bool rex_R   = false;
-	bool rex_X   = false;
-	bool rex_B   = false;
-
-	bool has_vex  = false;
-	bool vex_LL   = false;
-	bool vex_L    = false;
-	bool vex_RR   = false;
-	bool vex_zero = false; // Should zero or merge?; z field
-	std::int32_t vex_vec_bits = 0;
-	std::int32_t vex_size     = 0;
-	std::uint8_t vex_reg      = 0;
-	std::uint8_t vex_opmask   = 0;
-
-	VEX_rm vex_round_to = VEX_rm::mxcsr; // EVEX: Rounding mode
-	bool  vex_sae = false; // EVEX: suppress all exceptions
-	bool& vex_rc  = vex_sae; // EVEX: rounding, MXCSR override, implies SAE
-	bool& vex_broadcast = vex_sae; // EVEX: broadcast element across register
-
-	std::int32_t opcode_length = 0;
-	std::array<std::uint8_t, 3> opcode{ };
-
-	bool    has_modrm = false;
-	RM_mode modrm_mod = RM_mode::mem; // Mod R/M address mode
-	std::uint8_t modrm_reg = 0; // Register number or opcode information
-	std::uint8_t modrm_rm  = 0; // Operand register
-
-	bool has_sib = false;
-	std::uint8_t sib_scale = 0;
-	std::uint8_t sib_index = 0;
-	std::uint8_t sib_base  = 0;
-
-	bool has_disp = false;
-	std::int32_t disp_size = 0;
-	std::int32_t disp = 0;
-
-	bool has_imm  = false;
-	bool has_imm2 = false;
-	std::int32_t  imm_size  = 0;
-	std::int32_t  imm2_size = 0;
-	std::uint64_t imm  = 0;
-	std::uint64_t imm2 = 0;
+	bool has_rex() const { return has_rex_; }
+	bool rex_W()   const { return rex_W_; }
+	bool rex_R()   const { return rex_R_; }
+	bool rex_X()   const { return rex_X_; }
+	bool rex_B()   const { return rex_B_; }
+
+	bool has_vex()  const { return has_vex_; }
+	bool vex_LL()   const { return vex_LL_; }
+	bool vex_L()    const { return vex_L_; }
+	bool vex_RR()   const { return vex_RR_; }
+	bool vex_zero() const { return vex_zero_; }
+	std::int32_t vex_vec_bits() const { return vex_vec_bits_; }
+	std::int32_t vex_size()     const { return vex_size_; }
+	std::uint8_t vex_reg()      const { return vex_reg_; }
+	std::uint8_t vex_opmask()   const { return vex_opmask_; }
+
+	VEX_rm vex_round_to() const
+	{
+		return vex_round_to_ == 0x07 ? VEX_rm::mxcsr :
+		                               static_cast<VEX_rm>(vex_round_to_);
+	}
 
-	bool has_rel = false;
-	std::int32_t rel_size = 0;
+	bool vex_sae()       const { return vex_sae_; }
+	bool vex_rc()        const { return vex_sae_; }
+	bool vex_broadcast() const { return vex_sae_; }
+
+	std::int32_t opcode_length() const { return opcode_length_; }
+
+	std::array<std::uint8_t, 3> opcode() const
+	{
+		return {{ opcode_[0], opcode_[1], opcode_[2] }};
+	}
+
+	bool    has_modrm() const { return has_modrm_; }
+	RM_mode modrm_mod() const { return static_cast<RM_mode>(modrm_mod_); }
+	std::uint8_t modrm_reg() const { return modrm_reg_; }
+	std::uint8_t modrm_rm()  const { return modrm_rm_; }
+
+	bool has_sib() const { return has_sib_; }
+	std::uint8_t sib_scale() const { return has_sib_ ? 1U << sib_scale_ : 0; }
+	std::uint8_t sib_index() const { return sib_index_; }
+	std::uint8_t sib_base()  const { return sib_base_; }
+
+	bool has_disp() const { return has_disp_; }
+	std::int32_t disp_size() const { return disp_size_; }
+	std::int32_t disp()      const { return disp_; }
+
+	bool has_imm()  const { return has_imm_; }
+	bool has_imm2() const { return has_imm2_; }
+	std::int32_t  imm_size()  const { return imm_size_; }
+	std::int32_t  imm2_size() const { return imm2_size_; }
+	std::uint64_t imm()  const { return has_rel_ ? imm_ & 0xffffffff : imm_; }
+	std::uint64_t imm2() const { return imm2_; }
+
+	bool has_rel() const { return has_rel_; }
+	std::int32_t rel_size() const { return rel_size_; }
 	// abs = ip + rel
-	std::int32_t rel = 0;
+	std::int32_t rel() const
+	{
+		return has_rel_ ? static_cast<std::int32_t>(imm_ >> 32) : 0;
+	}
 
 private:
-	void internal_decode(const std::vector<std::uint8_t>&);
-	void decode_prefixes(const std::vector<std::uint8_t>&);
-	void decode_opcode(const std::vector<std::uint8_t>&);
-	void decode_vex(const std::vector<std::uint8_t>&);
-	void vex_decode_pp(std::uint8_t pp);
-	void vex_decode_mm(std::uint8_t mm);
-	void decode_modrm(const std::vector<std::uint8_t>&);
-	void decode_sib(const std::vector<std::uint8_t>&);
-	void rex_extend_modrm();
-	void read_imm(const std::vector<std::uint8_t>&);
-	void read_disp(const std::vector<std::uint8_t>&);
-
-	std::uint8_t get_byte(const std::vector<std::uint8_t>& buffer)
+	static constexpr Prefix group_0[4] =
 	{
-		if (pos < buffer.size())
-		{
-			length++;
-			return buffer[pos++];
-		}
-		else
-		{
-			signal_error(Error::eof);
-			return 0;
-		}
-	}
+		Prefix::none, Prefix::lock, Prefix::repnz, Prefix::repz
+	};
 
-	std::uint8_t peek_byte(const std::vector<std::uint8_t>& buffer,
-	                       std::size_t offset = 0) const
+	static constexpr Prefix group_1[8] =
 	{
-		return (pos + offset) < buffer.size() ? buffer[pos + offset] : 0;
+		Prefix::none,   Prefix::seg_cs, Prefix::seg_ss, Prefix::seg_ds,
+		Prefix::seg_es, Prefix::seg_fs, Prefix::seg_gs, Prefix::none
+	};
+
+	// Relative instructions never have an imm wider than 4 bytes, so rel
+	// is kept in the upper half of imm_
+	std::uint64_t imm_;
+	std::int32_t  disp_;
+	std::uint16_t imm2_;
+	std::uint8_t  opcode_[3];
+	std::uint8_t  error_flags_;
+
+	std::uint32_t length_       : 4;
+	std::uint32_t prefix_0_     : 2; // index in group_0
+	std::uint32_t prefix_1_     : 3; // index in group_1
+	std::uint32_t prefix_2_     : 1;
+	std::uint32_t prefix_3_     : 1;
+	std::uint32_t has_rex_      : 1;
+	std::uint32_t rex_W_        : 1;
+	std::uint32_t rex_R_        : 1;
+	std::uint32_t rex_X_        : 1;
+	std::uint32_t rex_B_        : 1;
+	std::uint32_t has_vex_      : 1;
+	std::uint32_t vex_LL_       : 1;
+	std::uint32_t vex_L_        : 1;
+	std::uint32_t vex_RR_       : 1;
+	std::uint32_t vex_zero_     : 1;
+	std::uint32_t vex_sae_      : 1;
+	std::uint32_t vex_vec_bits_ : 9;
+
+	std::uint32_t vex_size_      : 3;
+	std::uint32_t vex_opmask_    : 3;
+	std::uint32_t vex_reg_       : 5;
+	std::uint32_t vex_round_to_  : 3; // VEX_rm::mxcsr is stored as 0x07
+	std::uint32_t opcode_length_ : 2;
+	std::uint32_t has_modrm_     : 1;
+	std::uint32_t modrm_mod_     : 2;
+	std::uint32_t modrm_reg_     : 4;
+	std::uint32_t modrm_rm_      : 4;
+
+	std::uint32_t has_sib_   : 1;
+	std::uint32_t sib_scale_ : 2; // log2 of scale
+	std::uint32_t sib_index_ : 4;
+	std::uint32_t sib_base_  : 4;
+	std::uint32_t has_disp_  : 1;
+	std::uint32_t disp_size_ : 3;
+	std::uint32_t has_imm_   : 1;
+	std::uint32_t has_imm2_  : 1;
+	std::uint32_t imm_size_  : 4;
+	std::uint32_t imm2_size_ : 2;
+	std::uint32_t has_rel_   : 1;
+	std::uint32_t rel_size_  : 3;
+};
+
+static_assert(std::is_trivially_copyable<Inst_x64_packed>::value,
+              "Inst_x64_packed must stay trivially copyable");
+static_assert(sizeof(Inst_x64_packed) <= 32,
+              "Inst_x64_packed must fit in 32 bytes");
+
+
+// Result of the length decoder. Only the information needed to step over an
+// instruction is extracted; length, rel and error flags always match what
+// Inst_x64 would decode at the same position.
+struct Length_x64
+{
+	constexpr bool has_error(Inst_x64::Error signal) const
+	{
+		return (error_flags & static_cast<std::uint8_t>(signal)) ? true : false;
 	}
 
-	void signal_error(Error signal)
+	constexpr bool has_error() const
 	{
-		error_flags |= static_cast<std::uint8_t>(signal);
+		return error_flags != 0;
 	}
 
-	std::size_t pos = 0;
-	std::uint16_t flags = 0;
+
+	std::int32_t length = 0;
+
+	bool has_rel = false;
+	// abs = ip + rel
+	std::int32_t rel = 0;
+
 	std::uint8_t error_flags = 0;
 };
 
+// Length disassembler. Unlike Inst_x64, it doesn't fill in prefixes, Mod R/M,
+// SIB or immediate fields and only reads the immediate if it is relative.
+// Can be evaluated at compile time:
+//   constexpr std::uint8_t stub[] = { 0xe9, 0x00, 0x00, 0x00, 0x00 };
+//   static_assert(ssde::x64_length(stub) == 5, "");
+constexpr Length_x64 x64_decode_length(const std::uint8_t* buffer,
+                                       std::size_t size, std::size_t pos = 0)
+{
+	return detail::decode_length<Mode_x64, Length_x64>(
+		buffer, size, pos,
+		detail::scan_prefixes_scalar<Mode_x64>(buffer, size, pos));
+}
+
+template <std::size_t N>
+constexpr Length_x64 x64_decode_length(const std::uint8_t (&buffer)[N])
+{
+	return x64_decode_length(buffer, N);
+}
+
+constexpr std::int32_t x64_length(const std::uint8_t* buffer, std::size_t size,
+                                 std::size_t pos = 0)
+{
+	return x64_decode_length(buffer, size, pos).length;
+}
+
+template <std::size_t N>
+constexpr std::int32_t x64_length(const std::uint8_t (&buffer)[N])
+{
+	return x64_decode_length(buffer, N).length;
+}
+
+// Struct-of-arrays output of x64_decode_range. Arrays are owned by the
+// caller and must have room for capacity entries. target, has_rel and error
+// are optional and may be left null.
+struct Range_x64
+{
+	std::size_t*  offset  = nullptr; // where instruction starts
+	std::uint8_t* length  = nullptr;
+	std::int64_t* target  = nullptr; // offset + rel, valid if has_rel is set
+	std::uint8_t* has_rel = nullptr;
+	std::uint8_t* error   = nullptr; // Inst_x64::Error flags
+	std::size_t   capacity = 0;
+};
+
+// Linear sweep over [start, end) of buffer. Decodes instructions one after
+// another until end is reached or out is full and returns how many were
+// written. The last instruction may extend past end, but never past size.
+std::size_t x64_decode_range(const std::uint8_t* buffer, std::size_t size,
+                             std::size_t start, std::size_t end,
+                             const Range_x64& out);
+
+// Code to decode with x64_decode_streams: [start, end) of buffer, decoded into
+// out like x64_decode_range would. count is set to how many instructions
+// were written.
+struct Stream_x64
+{
+	const std::uint8_t* buffer = nullptr;
+	std::size_t size  = 0;
+	std::size_t start = 0;
+	std::size_t end   = 0;
+
+	Range_x64 out;
+	std::size_t count = 0;
+};
+
+// Linear sweep over many independent streams (functions, for example).
+// Same result as calling x64_decode_range on each stream, except that code
+// of upcoming streams is prefetched while the current one is decoded.
+void x64_decode_streams(Stream_x64* streams, std::size_t count);
+
+// Boundary predecoder. Marks where instructions start instead of decoding
+// them; bit n of the result is set if an instruction starts at block + n.
+// pos is where the first instruction in the block starts and is left at the
+// first one past the block, which is the pos to pass for the next block.
+// Runs of padding and zeroes are skipped 16 bytes at a time.
+std::uint64_t x64_predecode_block(const std::uint8_t* buffer, std::size_t size,
+                                  std::size_t block, std::size_t& pos);
+
+// Predecodes [start, end) of buffer into one mask per 64 bytes starting at
+// start; starts must have room for (end - start + 63) / 64 masks. Returns
+// where the instruction after the last marked one starts.
+std::size_t x64_predecode(const std::uint8_t* buffer, std::size_t size,
+                          std::size_t start, std::size_t end,
+                          std::uint64_t* starts);
+
 } // namespace ssde
 
 #endif // SSDE_X64_H
\ No newline at end of file
@@ -19,12 +19,24 @@
 // TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
 // SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
-// SSDE implementation for X86 arch
+// SSDE implementation for X86 arch, shared by 32 and 64 bit modes
 #include "ssde_x86.h"
+#include "ssde_x64.h"
+#include "ssde_x86_length.h"
+#include "ssde_x86_tables.h"
 #include <cstdint>
 #include <cstddef>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SSDE_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 
 // Major amounts of information this code was based on were taken from the
 // "Intel(R) 64 and IA-32 Architectures Software Developer's Manual". If You
@@ -32,7 +44,18 @@
 // the manuals first. The manuals can be obtained at
 //   http://www.intel.com/content/www/us/en/processors/architectures-software-developer-manuals.html
 
-using ssde::Inst_x86;
+using ssde::Inst_x86_core;
+using ssde::Mode_x86;
+using ssde::Mode_x64;
+using ssde::Length_x86;
+using ssde::Length_x64;
+using ssde::Range_x86;
+using ssde::Range_x64;
+using ssde::Stream_x86;
+using ssde::Stream_x64;
+using ssde::detail::Prefix_run;
+using ssde::detail::scan_prefixes_scalar;
+using ssde::detail::decode_length;
 using std::vector;
 using std::size_t;
 using std::uint8_t;
@@ -41,128 +64,114 @@ using std::uint32_t;
 using std::int8_t;
 using std::int16_t;
 using std::int32_t;
+using std::int64_t;
+using std::uint64_t;
+
+namespace opcodes      = ssde::detail::opcodes;
+namespace prefix_class = ssde::detail::prefix_class;
+namespace modrm_class  = ssde::detail::modrm_class;
+
 
+namespace
+{
+
+#ifdef SSDE_SSE2
 
-namespace opcodes
-{
-
-enum : uint16_t
-{
-	none = 0,
-
-	rm  = 1 << 0, // expect Mod byte
-	rel = 1 << 1, // instruction's imm is a relative address
-	i8  = 1 << 2, // has  8 bit imm
-	i16 = 1 << 3, // has 16 bit imm
-	i32 = 1 << 4, // has 32 bit imm, which can be turned to 16 with 66 prefix
-	am  = 1 << 5, // instruction uses address mode, imm is a memory address
-	vx  = 1 << 6, // instruction requires a VEX prefix
-	mp  = 1 << 7, // instruction has a mandatory 66 prefix
-
-	r8  = i8  | rel,
-	r32 = i32 | rel,
-
-	error = (uint16_t)-1
-};
-
-// 1st opcode flag table
-static const uint16_t table[256] =
-{
-	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
-	  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , error, // 0x
-	  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , none , // 1x
-	  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none , // 2x
-	  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none , // 3x
-	 none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , // 4x
-	 none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , // 5x
-	 none , none ,  rm  ,  rm  , error, error, error, error,  i32 ,rm|i32,  i8  , rm|i8, none , none , none , none , // 6x
-	  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  , // 7x
-	 rm|i8,rm|i32, rm|i8, rm|i8,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 8x
-	 none , none , none , none , none , none , none , none , none , none,i32|i16, error, none , none , none , none , // 9x
-	  am  ,  am  ,  am  ,  am  , none , none , none , none ,  i8  ,  i32 , none , none , none , none , none , none , // Ax
-	  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 , // Bx
-	 rm|i8, rm|i8,  i16 , none ,  rm  ,  rm  , rm|i8,rm|i32,i16|i8, none ,  i16 , none , none ,  i8  , none , none , // Cx
-	  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i8  , none , none ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Dx
-	  r8  ,  r8  ,  r8  ,  r8  ,  i8  ,  i8  ,  i8  ,  i8  ,  r32 ,  r32,i32|i16,  r8  , none , none , none , none , // Ex
-	 none , none , error, error, none , none , error, error, none , none , none , none , none , none ,  rm  ,  rm  , // Fx
-};
-
-// 2nd opcode flag table
-// 0F xx
-static const uint16_t table_0f[256] =
-{
-	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
-	  rm  ,  rm  ,  rm  ,  rm  , error, error, none , error, none , none , error, none , error,  rm  , none , error, // 0x
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 1x
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  , error,  rm  , error,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 2x
-	 none , none , none , none , none , none , error, none , error, error, error, error, error, error, error, error, // 3x
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 4x
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 5x
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 6x
-	 rm|i8, rm|i8, rm|i8, rm|i8,  rm  ,  rm  ,  rm  , none ,  rm  ,  rm  , error, error,  rm  ,  rm  ,  rm  ,  rm  , // 7x
-	  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 , // 8x
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 9x
-	 none , none , none ,  rm  , rm|i8,  rm  , error, error, none , none , none ,  rm  , rm|i8,  rm  ,  rm  ,  rm  , // Ax
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , none , rm|i8,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Bx
-	  rm  ,  rm  , rm|i8,  rm  , rm|i8, rm|i8, rm|i8,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Cx
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Dx
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Ex
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Fx
-};
-
-// 3rd opcode flag table
-// 0F 38 xx
-static const uint16_t table_38[256] =
-{
-	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
-	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , vx|rm, vx|rm, error, error, // 0x
-	 mp|rm, error, error, error, mp|rm, mp|rm, error, mp|rm, vx|rm, error, vx|rm, error,  rm  ,  rm  ,  rm  , error, // 1x
-	 mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, error, error, mp|rm, mp|rm, mp|rm, mp|rm, vx|rm, vx|rm, error, error, // 2x
-	 mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, error, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, // 3x
-	 mp|rm, mp|rm, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 4x
-	 error, error, error, error, error, error, error, error, vx|rm, vx|rm, error, error, error, error, error, error, // 5x
-	 error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 6x
-	 error, error, error, error, error, error, error, error, vx|rm, vx|rm, error, error, error, error, error, error, // 7x
-	 mp|rm, mp|rm, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 8x
-	 error, error, error, error, error, error, vx|rm, vx|rm, vx|rm, error, vx|rm, error, vx|rm, error, vx|rm, error, // 9x
-	 error, error, error, error, error, error, vx|rm, vx|rm, vx|rm, error, vx|rm, error, vx|rm, error, vx|rm, error, // Ax
-	 error, error, error, error, error, error, vx|rm, vx|rm, vx|rm, error, vx|rm, error, vx|rm, error, vx|rm, error, // Bx
-	 error, error, error, error, error, error, error, error,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , error, error, // Cx
-	 error, error, error, error, error, error, error, error, error, error, error,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Dx
-	 error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // Ex
-	  rm  ,  rm  , error, error, error, error,  rm  , error, error, error, error, error, error, error, error, error, // Fx
-};
-
-// 3rd opcode flag table
-// 0F 3A xx
-static const uint16_t table_3a[256] =
-{
-	// x0   |   x1   |   x2   |   x3   |   x4   |   x5   |   x6   |   x7   |   x8   |   x9   |   xA   |   xB   |   xC   |   xD   |   xE   |   xF
-	  error ,  error ,  error ,  error ,  error ,  error ,vx|rm|i8,  error ,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,   rm   , // 0x
-	  error ,  error ,  error ,  error ,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,vx|rm|i8,vx|rm|i8,  error ,  error ,  error ,  error ,  error ,  error , // 1x
-	mp|rm|i8,mp|rm|i8,mp|rm|i8,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 2x
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 3x
-	  mp|rm ,  mp|rm ,mp|rm|i8,  error ,  error ,  error ,  error ,  error ,  error ,  error ,vx|rm|i8,vx|rm|i8,vx|rm|i8,  error ,  error ,  error , // 4x
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 5x
-	mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,  error ,  error ,  error ,  error ,vx|rm|i8,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 6x
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 7x
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 8x
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 9x
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Ax
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Bx
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,mp|rm|i8,  error ,  error ,  error , // Cx
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Dx
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Ex
-	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Fx
-};
-
-} // namespace opcodes
-
-
-void Inst_x86::internal_decode(const vector<uint8_t>& buffer)
-{
-	decode_prefixes(buffer);
-	decode_opcode(buffer);
+inline uint32_t first_set(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Same as scan_prefixes_scalar, but classifies all 15 candidate bytes at
+// once. Requires 16 readable bytes.
+template <typename Mode>
+SSDE_INLINE Prefix_run scan_prefixes_sse2(const uint8_t* bytes)
+{
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+
+	auto is = [&v](uint8_t value)
+	{
+		return _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(value)));
+	};
+
+	// bit n of each mask is set if byte n belongs to that group
+
+	uint32_t group_0 = _mm_movemask_epi8(
+		_mm_or_si128(_mm_or_si128(is(0xf0), is(0xf2)), is(0xf3)));
+	uint32_t group_1 = _mm_movemask_epi8(
+		_mm_or_si128(_mm_or_si128(_mm_or_si128(is(0x2e), is(0x36)),
+		                          _mm_or_si128(is(0x3e), is(0x26))),
+		             _mm_or_si128(is(0x64), is(0x65))));
+	uint32_t group_2 = _mm_movemask_epi8(is(0x66));
+	uint32_t group_3 = _mm_movemask_epi8(is(0x67));
+	uint32_t rex = !Mode::long_mode ? 0 : _mm_movemask_epi8(
+		_mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(0xf0 - 0x100)),
+		               _mm_set1_epi8(0x40)));
+
+	// 16th byte always ends the run, just like the 15 step loop does
+	uint32_t any = group_0 | group_1 | group_2 | group_3 | rex;
+
+	Prefix_run run;
+	run.length = first_set(~any | 0x8000);
+
+	uint32_t in_run = (1U << run.length) - 1;
+
+	// byte n is kept at copy[n + 1], which makes copy[0] and copy[17] zero
+	// and lets a missing group or REX select a zero byte without branches
+	uint8_t copy[18] = { };
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(copy + 1), v);
+
+	run.group[0] = copy[first_set((group_0 & in_run) | 0x10000) + 1];
+	run.group[1] = copy[first_set((group_1 & in_run) | 0x10000) + 1];
+	run.group[2] = copy[first_set((group_2 & in_run) | 0x10000) + 1];
+	run.group[3] = copy[first_set((group_3 & in_run) | 0x10000) + 1];
+
+	// REX only counts if it is the last byte of the run
+	uint8_t last_is_rex = ((rex << 1) >> run.length) & 1;
+	run.rex = copy[run.length] & static_cast<uint8_t>(0 - last_is_rex);
+
+	return run;
+}
+
+#endif // SSDE_SSE2
+
+// Forced inline, as with more than one caller per mode compilers tend to
+// leave it out of line, which costs about a third of the throughput
+template <typename Mode>
+SSDE_INLINE Prefix_run scan_prefixes(const uint8_t* buffer, size_t size,
+                                     size_t pos)
+{
+#ifdef SSDE_SSE2
+	if (size >= 16 && pos <= size - 16)
+		return scan_prefixes_sse2<Mode>(buffer + pos);
+#endif
+
+	return scan_prefixes_scalar<Mode>(buffer, size, pos);
+}
+
+} // namespace
+
+constexpr bool Mode_x86::long_mode;
+constexpr bool Mode_x64::long_mode;
+constexpr int32_t Mode_x86::address_size;
+constexpr int32_t Mode_x64::address_size;
+constexpr bool Mode_x86::Fields::has_rex;
+constexpr bool Mode_x86::Fields::rex_W;
+constexpr bool Mode_x86::Fields::rex_R;
+constexpr bool Mode_x86::Fields::rex_X;
+constexpr bool Mode_x86::Fields::rex_B;
+
+template <typename Mode>
+void Inst_x86_core<Mode>::internal_decode(const uint8_t* buffer, size_t size)
+{
+	decode_prefixes(buffer, size);
+	decode_opcode(buffer, size);
 
 	if (flags != opcodes::error)
 	{
@@ -175,13 +184,15 @@ void Inst_x86::internal_decode(const vector<uint8_t>& buffer)
 
 		if (flags & opcodes::rm)
 		{
-			decode_modrm(buffer);
+			decode_modrm(buffer, size);
 
 			if (has_sib)
-				decode_sib(buffer);
+				decode_sib(buffer, size);
+
+			rex_extend_modrm();
 
 			if (has_disp)
-				read_disp(buffer);
+				read_disp(buffer, size);
 		}
 		else if (prefixes[0] == Prefix::lock)
 		{
@@ -191,7 +202,7 @@ void Inst_x86::internal_decode(const vector<uint8_t>& buffer)
 		}
 
 		// read moffs, imm or rel
-		read_imm(buffer);
+		read_imm(buffer, size);
 
 		if (length > 15)
 		{
@@ -206,7 +217,8 @@ void Inst_x86::internal_decode(const vector<uint8_t>& buffer)
 	}
 }
 
-void Inst_x86::decode_prefixes(const vector<uint8_t>& buffer)
+template <typename Mode>
+void Inst_x86_core<Mode>::decode_prefixes(const uint8_t* buffer, size_t size)
 {
 	// This is prefix analyzer. It behaves exactly the same way real CPUs
 	// analyze instructions for prefixes. Normally, each instruction is
@@ -216,66 +228,68 @@ void Inst_x86::decode_prefixes(const vector<uint8_t>& buffer)
 	// can only handle words up to 15 bytes long, if the word is longer than
 	// that, decoder will fail.
 
-	for (int32_t i = 0; i < 15; ++i, ++length)
-	{
-		Prefix pref = static_cast<Prefix>(peek_byte(buffer));
+	Prefix_run run = scan_prefixes<Mode>(buffer, size, pos);
 
-		if (pref == Prefix::lock ||
-		    pref == Prefix::repnz ||
-		    pref == Prefix::repz)
-		{
-			if (prefixes[0] == Prefix::none)
-				prefixes[0] = pref;
-		}
-		else if (pref == Prefix::seg_cs || pref == Prefix::seg_ss ||
-		         pref == Prefix::seg_ds || pref == Prefix::seg_es ||
-		         pref == Prefix::seg_fs || pref == Prefix::seg_gs)
-		{
-			if (prefixes[1] == Prefix::none)
-				prefixes[1] = pref;
-		}
-		else if (pref == Prefix::p66)
-		{
-			if (prefixes[2] == Prefix::none)
-				prefixes[2] = pref;
-		}
-		else if (pref == Prefix::p67)
-		{
-			if (prefixes[3] == Prefix::none)
-				prefixes[3] = pref;
-		}
-		else
-		{
-			break;
-		}
-	}
+	for (int32_t i = 0; i < 4; ++i)
+		prefixes[i] = static_cast<Prefix>(run.group[i]);
+
+	if (run.rex != 0)
+		decode_rex(run.rex);
+
+	length += run.length;
+	pos    += run.length;
+}
+
+namespace ssde
+{
+
+template <>
+void Inst_x86_core<Mode_x86>::decode_rex(uint8_t)
+{
+	// 40-4F are opcodes in 32 bit mode, scan_prefixes never yields REX
 }
 
-void Inst_x86::decode_opcode(const vector<uint8_t>& buffer)
+template <>
+void Inst_x86_core<Mode_x64>::decode_rex(uint8_t rex)
 {
-	uint8_t byte_0 = peek_byte(buffer);
+	has_rex = true;
+
+	rex_W = (rex & 0x08) ? true : false;
+	rex_R = (rex & 0x04) ? true : false;
+	rex_X = (rex & 0x02) ? true : false;
+	rex_B = (rex & 0x01) ? true : false;
+}
+
+} // namespace ssde
 
-	if ((peek_byte(buffer, 1) & 0xc0) == 0xc0 &&
+template <typename Mode>
+void Inst_x86_core<Mode>::decode_opcode(const uint8_t* buffer, size_t size)
+{
+	uint8_t byte_0 = peek_byte(buffer, size);
+
+	// In 32 bit mode C4, C5 and 62 are LES, LDS and BOUND unless followed
+	// by what would be a register operand
+	if ((Mode::long_mode || (peek_byte(buffer, size, 1) & 0xc0) == 0xc0) &&
 	    (byte_0 == 0xc4 ||
 	     byte_0 == 0xc5 ||
 	     byte_0 == 0x62))
 	{
 		// looks like we've found a VEX prefix
 
-		decode_vex(buffer);
+		decode_vex(buffer, size);
 	}
 	else
 	{
-		opcode[0] = get_byte(buffer);
-		opcode[1] = opcode[0] == 0x0f ? get_byte(buffer) : 0;
+		opcode[0] = get_byte(buffer, size);
+		opcode[1] = opcode[0] == 0x0f ? get_byte(buffer, size) : 0;
 		opcode[2] = (opcode[1] == 0x38 || opcode[1] == 0x3a) ?
-		            get_byte(buffer) : 0;
+		            get_byte(buffer, size) : 0;
 	}
 
 	if (opcode[0] != 0x0f)
 	{
 		opcode_length = 1;
-		flags = opcodes::table[opcode[0]];
+		flags = opcodes::table[Mode::long_mode][opcode[0]];
 	}
 	else
 	{
@@ -298,60 +312,47 @@ void Inst_x86::decode_opcode(const vector<uint8_t>& buffer)
 		}
 	}
 
-	if (!has_vex && (flags & opcodes::vx))
+	if (flags == opcodes::gp)
 	{
-		// this instruction can only be VEX-encoded
-
-		signal_error(Error::no_vex);
-	}
+		// F6 and F7 extend using 3 bits of Mod R/M byte and, unlike other
+		// extended opcodes, their imm depends on the extension
 
+		uint8_t op_ex = (peek_byte(buffer, size) >> 3) & 0x07;
 
-	// These are two exceptional opcodes that extend using 3 bits of Mod R/M
-	// byte and they lack consistent flags. Instead of creating a new flags
-	// table for each extended opcode, I decided to put this little bit of code
-	// that is dedicated to these two exceptional opcodes.
-
-	if (opcode[0] == 0xf6)
-	{
-		uint8_t op_ex = (peek_byte(buffer) >> 3) & 0x07;
-
-		if (op_ex == 0x00 || op_ex == 0x01)
-			flags = opcodes::rm | opcodes::i8;
-		else
-			flags = opcodes::rm;
+		flags = opcodes::table_gp[opcode[0] & 0x01][op_ex];
 	}
-	else if (opcode[0] == 0xf7)
+
+	if (!has_vex && (flags & opcodes::vx))
 	{
-		uint8_t op_ex = (peek_byte(buffer) >> 3) & 0x07;
+		// this instruction can only be VEX-encoded
 
-		if (op_ex == 0x00 || op_ex == 0x01)
-			flags = opcodes::rm | opcodes::i32;
-		else
-			flags = opcodes::rm;
+		signal_error(Error::no_vex);
 	}
 }
 
-void Inst_x86::decode_vex(const vector<uint8_t>& buffer)
+template <typename Mode>
+void Inst_x86_core<Mode>::decode_vex(const uint8_t* buffer, size_t size)
 {
 	has_vex = true;
 
 	if (has_prefix())
 		signal_error(Error::opcode);
 
-	uint8_t byte_0 = get_byte(buffer);
+	uint8_t byte_0 = get_byte(buffer, size);
 
 	if (byte_0 == 0xc5)
 	{
 		vex_size = 2;
 
-		uint8_t byte_1 = get_byte(buffer);
+		uint8_t byte_1 = get_byte(buffer, size);
 
+		vex_decode_rex(byte_1, 0);
 		vex_L = (byte_1 & 0x04) ? true : false;
 		// determine destination register from vvvv
 		vex_reg = (~byte_1 >> 3) & 0x0f;
 
 		opcode[0] = 0x0f;
-		opcode[1] = get_byte(buffer);
+		opcode[1] = get_byte(buffer, size);
 
 		// read prefix bytes from pp field
 		vex_decode_pp(byte_1 & 0x03);
@@ -362,17 +363,17 @@ void Inst_x86::decode_vex(const vector<uint8_t>& buffer)
 	{
 		vex_size = 3;
 
-		uint8_t byte_1 = get_byte(buffer);
-		uint8_t byte_2 = get_byte(buffer);
+		uint8_t byte_1 = get_byte(buffer, size);
+		uint8_t byte_2 = get_byte(buffer, size);
 
-		// 3 byte VEX stores REX bits inverted in 2nd byte
+		vex_decode_rex(byte_1, byte_2);
 		vex_L = (byte_2 & 0x04) ? true : false;
 		// determine destination register from vvvv
 		vex_reg = (~byte_2 >> 3) & 0x0f;
 
 		// read opcode bytes from mm field
 		vex_decode_mm(byte_1 & 0x1f);
-		opcode[opcode[1] != 0 ? 2 : 1] = get_byte(buffer);
+		opcode[opcode[1] != 0 ? 2 : 1] = get_byte(buffer, size);
 
 		// read prefix bytes from pp field
 		vex_decode_pp(byte_2 & 0x03);
@@ -383,12 +384,14 @@ void Inst_x86::decode_vex(const vector<uint8_t>& buffer)
 	{
 		vex_size = 4;
 
-		uint8_t byte_1 = get_byte(buffer);
-		uint8_t byte_2 = get_byte(buffer);
-		uint8_t byte_3 = get_byte(buffer);
+		uint8_t byte_1 = get_byte(buffer, size);
+		uint8_t byte_2 = get_byte(buffer, size);
+		uint8_t byte_3 = get_byte(buffer, size);
+
+		vex_decode_rex(byte_1, byte_2);
 
 		vex_decode_mm(byte_1 & 0x03);
-		opcode[opcode[1] != 0 ? 2 : 1] = get_byte(buffer);
+		opcode[opcode[1] != 0 ? 2 : 1] = get_byte(buffer, size);
 
 		// determine destination register from vvvv
 		vex_reg = ((~byte_2 >> 3) & 0x0f) | ((byte_3 & 0x80) ? 0x10 : 0);
@@ -406,7 +409,7 @@ void Inst_x86::decode_vex(const vector<uint8_t>& buffer)
 		{
 			// rounding control, implies vector is 512 bits wide
 
-			vex_round_to = static_cast<VEX_rm>((vex_L  ? 0x1 : 0) |
+			vex_round_to = static_cast<VEX_rm>((vex_L ? 0x1 : 0) |
 			                                   (vex_LL ? 0x2 : 0));
 			vex_L  = false;
 			vex_LL = true;
@@ -425,7 +428,49 @@ void Inst_x86::decode_vex(const vector<uint8_t>& buffer)
 	// byte_0 is guaranteed to be one of values in if cascade
 }
 
-void Inst_x86::vex_decode_pp(uint8_t pp)
+namespace ssde
+{
+
+template <>
+void Inst_x86_core<Mode_x86>::vex_decode_rex(uint8_t, uint8_t)
+{
+	// REX bits of VEX are ignored outside of 64 bit mode
+}
+
+template <>
+void Inst_x86_core<Mode_x64>::vex_decode_rex(uint8_t byte_1, uint8_t byte_2)
+{
+	if (has_rex)
+		signal_error(Error::rex);
+
+	switch (vex_size)
+	{
+	case 2:
+		rex_R = (byte_1 & 0x80) ? false : true;
+		break;
+
+	case 3:
+		// 3 byte VEX stores REX bits inverted in 2nd byte
+		rex_R = (byte_1 & 0x80) ? false : true;
+		rex_X = (byte_1 & 0x40) ? false : true;
+		rex_B = (byte_1 & 0x20) ? false : true;
+		rex_W = (byte_2 & 0x80) ? true : false;
+		break;
+
+	case 4:
+		rex_R  = (byte_1 & 0x80) ? true : false;
+		rex_X  = (byte_1 & 0x40) ? true : false;
+		rex_B  = (byte_1 & 0x20) ? true : false;
+		vex_RR = (byte_1 & 0x10) ? true : false;
+		rex_W  = (byte_2 & 0x80) ? true : false;
+		break;
+	}
+}
+
+} // namespace ssde
+
+template <typename Mode>
+void Inst_x86_core<Mode>::vex_decode_pp(uint8_t pp)
 {
 	switch (pp)
 	{
@@ -446,7 +491,8 @@ void Inst_x86::vex_decode_pp(uint8_t pp)
 	}
 }
 
-void Inst_x86::vex_decode_mm(uint8_t mm)
+template <typename Mode>
+void Inst_x86_core<Mode>::vex_decode_mm(uint8_t mm)
 {
 	switch (mm)
 	{
@@ -470,83 +516,75 @@ void Inst_x86::vex_decode_mm(uint8_t mm)
 	}
 }
 
-void Inst_x86::decode_modrm(const vector<uint8_t>& buffer)
+template <typename Mode>
+void Inst_x86_core<Mode>::decode_modrm(const uint8_t* buffer, size_t size)
 {
-	uint8_t modrm_byte = get_byte(buffer);
+	uint8_t modrm_byte = get_byte(buffer, size);
 
 	has_modrm = true;
 	modrm_mod = static_cast<RM_mode>((modrm_byte >> 6) & 0x03);
 	modrm_reg = (modrm_byte >> 3) & 0x07;
 	modrm_rm  = modrm_byte & 0x07;
 
-	switch (modrm_mod)
+	uint8_t desc = modrm_class::table[prefixes[3] == Prefix::p67][modrm_byte];
+
+	has_sib   = (desc & modrm_class::sib) ? true : false;
+	disp_size = desc & modrm_class::disp_size;
+	has_disp  = disp_size != 0;
+
+	if ((desc & modrm_class::reg) && prefixes[0] == Prefix::lock)
 	{
-	case RM_mode::mem:
-		if (prefixes[3] == Prefix::p67)
-		{
-			if (modrm_rm == 0x06)
-			{
-				has_disp  = true;
-				disp_size = 2;
-			}
-		}
-		else
-		{
-			if (modrm_rm == 0x04)
-				has_sib = true;
+		// LOCK prefix is not allowed to be used with Mod R
 
-			if (modrm_rm == 0x05)
-			{
-				has_disp  = true;
-				disp_size = 4;
-			}
-		}
-		break;
+		signal_error(Error::lock);
+	}
+}
 
-	case RM_mode::mem_disp8:
-		{
-			if (prefixes[3] != Prefix::p67 && modrm_rm == 0x04)
-				has_sib = true;
+template <typename Mode>
+void Inst_x86_core<Mode>::decode_sib(const uint8_t* buffer, size_t size)
+{
+	uint8_t sib_byte = get_byte(buffer, size);
 
-			has_disp  = true;
-			disp_size = 1;
-		}
-		break;
+	sib_scale = 1U << ((sib_byte >> 6) & 0x03);
+	sib_index = (sib_byte >> 3) & 0x07;
+	sib_base  = sib_byte & 0x07;
+}
 
-	case RM_mode::mem_disp32:
-		{
-			if (prefixes[3] != Prefix::p67 && modrm_rm == 0x04)
-				has_sib = true;
+template <typename Mode>
+void Inst_x86_core<Mode>::rex_extend_modrm()
+{
+	// no-op in 32 bit mode, where all REX bits are false
 
-			has_disp  = true;
-			disp_size = prefixes[3] != Prefix::p67 ? 4 : 2;
-		}
-		break;
+	if (has_sib)
+	{
+		modrm_reg |= this->rex_R ? 0x08 : 0;
 
-	case RM_mode::reg:
-		if (prefixes[0] == Prefix::lock)
+		sib_index |= this->rex_X ? 0x08 : 0;
+		sib_base  |= this->rex_B ? 0x08 : 0;
+	}
+	else
+	{
+		if (flags & opcodes::ox)
 		{
-			// LOCK prefix is not allowed to be used with Mod R
+			// Mod extended opcodes are extended differently
 
-			signal_error(Error::lock);
+			modrm_reg |= this->rex_B ? 0x08 : 0;
+		}
+		else
+		{
+			modrm_reg |= this->rex_R ? 0x08 : 0;
+			modrm_rm  |= this->rex_B ? 0x08 : 0;
 		}
-		break;
 	}
 }
 
-void Inst_x86::decode_sib(const vector<uint8_t>& buffer)
+template <typename Mode>
+void Inst_x86_core<Mode>::read_disp(const uint8_t* buffer, size_t size)
 {
-	uint8_t sib_byte = get_byte(buffer);
-
-	sib_scale = 1U << ((sib_byte >> 6) & 0x03);
-	sib_index = (sib_byte >> 3) & 0x07;
-	sib_base  = sib_byte & 0x07;
-}
+	disp = 0;
 
-void Inst_x86::read_disp(const vector<uint8_t>& buffer)
-{
 	for (int32_t i = 0; i < disp_size; ++i)
-		disp |= static_cast<int32_t>(get_byte(buffer)) << i*8;
+		disp |= static_cast<int32_t>(get_byte(buffer, size)) << i*8;
 
 	if (disp & (1U << (disp_size*8 - 1)))
 	{
@@ -566,21 +604,26 @@ void Inst_x86::read_disp(const vector<uint8_t>& buffer)
 	}
 }
 
-void Inst_x86::read_imm(const vector<uint8_t>& buffer)
+template <typename Mode>
+void Inst_x86_core<Mode>::read_imm(const uint8_t* buffer, size_t size)
 {
+	using Imm = typename Mode::Imm;
+
 	if (flags & opcodes::am)
 	{
 		// address mode instructions use a different prefix
 
 		has_imm  = true;
-		imm_size = prefixes[3] != Prefix::p67 ? 4 : 2;
+		imm_size = prefixes[3] != Prefix::p67 ? Mode::address_size :
+		                                        Mode::address_size / 2;
 	}
 	else
 	{
 		if (flags & opcodes::i32)
 		{
 			has_imm  = true;
-			imm_size = prefixes[2] != Prefix::p66 ? 4 : 2;
+			imm_size = (this->rex_W && (flags & opcodes::rw)) ? 8 :
+			           prefixes[2] != Prefix::p66 ? 4 : 2;
 		}
 
 		if (flags & opcodes::i16)
@@ -617,14 +660,14 @@ void Inst_x86::read_imm(const vector<uint8_t>& buffer)
 		imm = 0;
 
 		for (int32_t i = 0; i < imm_size; ++i)
-			imm |= static_cast<uint32_t>(get_byte(buffer)) << i*8;
+			imm |= static_cast<Imm>(get_byte(buffer, size)) << i*8;
 
 		if (has_imm2)
 		{
 			imm2 = 0;
 
 			for (int32_t i = 0; i < imm2_size; ++i)
-				imm2 |= static_cast<uint32_t>(get_byte(buffer)) << i*8;
+				imm2 |= static_cast<Imm>(get_byte(buffer, size)) << i*8;
 		}
 	}
 
@@ -633,7 +676,7 @@ void Inst_x86::read_imm(const vector<uint8_t>& buffer)
 		has_imm = false;
 
 		rel_size = imm_size;
-		rel = static_cast<int32_t>(imm) + static_cast<int32_t>(length);
+		rel = static_cast<int32_t>(imm);
 
 		if (rel & (1U << (rel_size*8 - 1)))
 		{
@@ -652,6 +695,241 @@ void Inst_x86::read_imm(const vector<uint8_t>& buffer)
 			}
 		}
 
+		// rel is relative to the end of the instruction
+		rel += static_cast<int32_t>(length);
+
 		has_rel = true;
 	}
-}
\ No newline at end of file
+}
+
+template class ssde::Inst_x86_core<Mode_x86>;
+template class ssde::Inst_x86_core<Mode_x64>;
+
+
+namespace
+{
+
+template <typename Mode, typename Length, typename Range>
+size_t decode_range(const uint8_t* buffer, size_t size,
+                    size_t start, size_t end, const Range& out)
+{
+	size_t count = 0;
+
+	if (end > size)
+		end = size;
+
+	for (size_t pos = start; pos < end && count < out.capacity; ++count)
+	{
+		Length inst = decode_length<Mode, Length>(
+			buffer, size, pos, scan_prefixes_scalar<Mode>(buffer, size, pos));
+
+		out.offset[count] = pos;
+		out.length[count] = static_cast<uint8_t>(inst.length);
+
+		if (out.target)
+			out.target[count] = static_cast<int64_t>(pos) + inst.rel;
+
+		if (out.has_rel)
+			out.has_rel[count] = inst.has_rel;
+
+		if (out.error)
+			out.error[count] = inst.error_flags;
+
+		pos += inst.length;
+	}
+
+	return count;
+}
+
+// Bits n to 63 set
+inline uint64_t from_bit(size_t n)
+{
+	return n < 64 ? ~uint64_t(0) << n : 0;
+}
+
+#ifdef SSDE_SSE2
+
+// Runs of INT3 and NOP padding are one instruction per byte and runs of
+// zeroes (add [eax], al) are one per two bytes. Marks instruction starts of
+// such a run at pos (bit 0 of the result is pos) and returns its length,
+// which is 0 if there is none. Requires 16 readable bytes.
+inline uint32_t predecode_padding(const uint8_t* bytes, uint64_t& starts)
+{
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+
+	uint32_t one_byte = _mm_movemask_epi8(_mm_or_si128(
+		_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0xcc))),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0x90)))));
+	uint32_t zero = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+
+	uint32_t run = first_set(~one_byte | 0x10000);
+
+	if (run != 0)
+	{
+		starts = (uint64_t(1) << run) - 1;
+		return run;
+	}
+
+	// A zero followed by a non zero byte may be a longer instruction
+	run = first_set(~zero | 0x10000) & ~1u;
+
+	starts = 0x5555 & ((uint64_t(1) << run) - 1);
+	return run;
+}
+
+#endif // SSDE_SSE2
+
+// Marks instruction starts in the block [block, block + 64) of buffer,
+// beginning with the instruction at pos. Stops at end, leaves pos at the
+// first instruction past the block.
+template <typename Mode, typename Length>
+uint64_t predecode_block(const uint8_t* buffer, size_t size, size_t end,
+                         size_t block, size_t& pos)
+{
+	uint64_t starts = 0;
+
+	if (end > block + 64)
+		end = block + 64;
+
+	while (pos < end)
+	{
+#ifdef SSDE_SSE2
+		const uint8_t byte = buffer[pos];
+
+		if ((byte == 0xcc || byte == 0x90 || byte == 0x00) &&
+		    size >= 16 && pos <= size - 16)
+		{
+			uint64_t run_starts;
+			size_t run = predecode_padding(buffer + pos, run_starts);
+
+			// Part of the run that is past end is left for the next block,
+			// which must begin at an instruction start
+			if (run > end - pos)
+				run = byte == 0x00 ? (end - pos) & ~size_t(1) : end - pos;
+
+			if (run != 0)
+			{
+				starts |= (run_starts & ~from_bit(run)) << (pos - block);
+				pos += run;
+				continue;
+			}
+		}
+#endif
+
+		starts |= uint64_t(1) << (pos - block);
+
+		pos += decode_length<Mode, Length>(
+			buffer, size, pos, scan_prefixes_scalar<Mode>(buffer, size, pos)).length;
+	}
+
+	return starts;
+}
+
+// Starts loading the cache line at address
+inline void prefetch(const uint8_t* address)
+{
+#if defined(SSDE_SSE2)
+	_mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(address);
+#endif
+}
+
+// Decodes streams one after another, while the first bytes of streams
+// further down the list are being loaded. Streams are usually small and
+// scattered over an image, so most of them would start with cache misses.
+template <typename Mode, typename Length, typename Stream>
+void decode_streams(Stream* streams, size_t count)
+{
+	const size_t ahead = 8;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i + ahead < count)
+		{
+			const Stream& next = streams[i + ahead];
+
+			if (next.start < next.size)
+				prefetch(next.buffer + next.start);
+
+			if (next.start + 64 < next.size)
+				prefetch(next.buffer + next.start + 64);
+		}
+
+		Stream& stream = streams[i];
+
+		stream.count = decode_range<Mode, Length>(
+			stream.buffer, stream.size, stream.start, stream.end, stream.out);
+	}
+}
+
+template <typename Mode, typename Length>
+size_t predecode(const uint8_t* buffer, size_t size,
+                 size_t start, size_t end, uint64_t* starts)
+{
+	if (end > size)
+		end = size;
+
+	size_t pos = start;
+
+	for (size_t block = start; block < end; block += 64)
+	{
+		*starts++ = predecode_block<Mode, Length>(buffer, size, end, block,
+		                                          pos);
+	}
+
+	return pos;
+}
+
+} // namespace
+
+
+size_t ssde::x86_decode_range(const uint8_t* buffer, size_t size,
+                              size_t start, size_t end,
+                              const Range_x86& out)
+{
+	return decode_range<Mode_x86, Length_x86>(buffer, size, start, end, out);
+}
+
+size_t ssde::x64_decode_range(const uint8_t* buffer, size_t size,
+                              size_t start, size_t end,
+                              const Range_x64& out)
+{
+	return decode_range<Mode_x64, Length_x64>(buffer, size, start, end, out);
+}
+
+uint64_t ssde::x86_predecode_block(const uint8_t* buffer, size_t size,
+                                   size_t block, size_t& pos)
+{
+	return predecode_block<Mode_x86, Length_x86>(buffer, size, size, block,
+	                                             pos);
+}
+
+uint64_t ssde::x64_predecode_block(const uint8_t* buffer, size_t size,
+                                   size_t block, size_t& pos)
+{
+	return predecode_block<Mode_x64, Length_x64>(buffer, size, size, block,
+	                                             pos);
+}
+
+size_t ssde::x86_predecode(const uint8_t* buffer, size_t size,
+                           size_t start, size_t end, uint64_t* starts)
+{
+	return predecode<Mode_x86, Length_x86>(buffer, size, start, end, starts);
+}
+
+size_t ssde::x64_predecode(const uint8_t* buffer, size_t size,
+                           size_t start, size_t end, uint64_t* starts)
+{
+	return predecode<Mode_x64, Length_x64>(buffer, size, start, end, starts);
+}
+
+void ssde::x86_decode_streams(Stream_x86* streams, size_t count)
+{
+	decode_streams<Mode_x86, Length_x86>(streams, count);
+}
+
+void ssde::x64_decode_streams(Stream_x64* streams, size_t count)
+{
+	decode_streams<Mode_x64, Length_x64>(streams, count);
+}
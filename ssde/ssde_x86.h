@@ -21,6 +21,8 @@
 #ifndef SSDE_X86_H
 #define SSDE_X86_H
 
+#include "ssde_x86_core.h"
+#include "ssde_x86_length.h"
 #include <cstdint>
 #include <cstddef>
 #include <vector>
@@ -30,86 +32,25 @@
 namespace ssde
 {
 
-class Inst_x86
+// Instruction decoded in 32 bit mode, see Inst_x86_core
+class Inst_x86 : public Inst_x86_core<Mode_x86>
 {
 public:
-	enum class Error : std::uint8_t
-	{
-		eof     = 1 << 0, // Reached end of buffer before finished decoding
-		length  = 1 << 1, // Instruction is too long
-		opcode  = 1 << 2, // Instruction doesn't exist
-		operand = 1 << 3, // Operands don't match instruction's requirements
-		no_vex  = 1 << 4, // Instruction should've been VEX encoded
-		lock    = 1 << 5, // LOCK prefix is not allowed
-	};
-
-	enum class Prefix : std::uint8_t // X86 instruction prefix
-	{
-		none             = 0x00,
-		seg_cs           = 0x2e,
-		seg_ss           = 0x36,
-		seg_ds           = 0x3e,
-		seg_es           = 0x26,
-		seg_fs           = 0x64,
-		seg_gs           = 0x65,
-		lock             = 0xf0,
-		repnz            = 0xf2,
-		repz             = 0xf3,
-		p66              = 0x66,
-		p67              = 0x67,
-		branch_taken     = 0x3e,
-		branch_not_taken = 0x2e,
-		fpu_double       = 0xf2,
-		fpu_single       = 0xf3,
-	};
-
-	enum class VEX_rm : std::uint8_t // EVEX rounding mode
-	{
-		near  = 0x00,
-		floor = 0x01,
-		ceil  = 0x02,
-		trunc = 0x03,
-		none  = 0xff,
-		mxcsr = 0xff,
-	};
-
-	enum class RM_mode : std::uint8_t // Mod R/M addressing mode
-	{
-		mem        = 0x00, // [r]
-		mem_disp8  = 0x01, // [r]+disp8
-		mem_disp32 = 0x02, // [r]+disp32
-		reg        = 0x03, // r
-	};
-
-
-	Inst_x86()
-	{
-	}
-
-	Inst_x86(const std::vector<std::uint8_t>& buffer, std::size_t in_pos = 0) :
-		pos(in_pos)
-	{
-		internal_decode(buffer);
-	}
-
-	bool has_prefix(Prefix pref) const
-	{
-		return (prefixes[0] == pref || prefixes[1] == pref ||
-		        prefixes[2] == pref || prefixes[3] == pref);
-	}
+	using Inst_x86_core<Mode_x86>::Inst_x86_core;
+};
 
-	bool has_prefix() const
-	{
-		return (prefixes[0] != Prefix::none || prefixes[1] != Prefix::none ||
-		        prefixes[2] != Prefix::none || prefixes[3] != Prefix::none);
-	}
 
-	bool has_error(Error signal) const
+// Result of the length decoder. Only the information needed to step over an
+// instruction is extracted; length, rel and error flags always match what
+// Inst_x86 would decode at the same position.
+struct Length_x86
+{
+	constexpr bool has_error(Inst_x86::Error signal) const
 	{
 		return (error_flags & static_cast<std::uint8_t>(signal)) ? true : false;
 	}
 
-	bool has_error() const
+	constexpr bool has_error() const
 	{
 		return error_flags != 0;
 	}
@@ -117,100 +58,98 @@ public:
 
 	std::int32_t length = 0;
 
-	// Instruction's prefixes (grouped)
-
-	// To check if instruction has prefix, use Inst_x86::has_prefix
-	// 0: LOCK, REPNZ and REPZ prefixes and/or FPU op. size modifiers
-	// 1: Segment (seg_*) prefixes and/or branch hints
-	// 2: Operand size override prefix (p66)
-	// 3: Address size override prefix (p67)
-	std::array<Prefix, 4> prefixes{ };
-
-	bool has_vex = false;
-	bool vex_LL  = false;
-	bool vex_L   = false;
-
-	bool vex_zero = false; // Should zero or merge?; z field
-	std::int32_t vex_vec_bits = 0;
-	std::int32_t vex_size     = 0;
-	std::uint8_t vex_reg      = 0;
-	std::uint8_t vex_opmask   = 0;
-	VEX_rm vex_round_to = VEX_rm::mxcsr; // EVEX: Rounding mode
-	bool  vex_sae = false; // EVEX: suppress all exceptions
-	bool& vex_rc  = vex_sae; // EVEX: rounding, MXCSR override, implies SAE
-	bool& vex_broadcast = vex_sae; // EVEX: broadcast element across register
-
-	std::int32_t opcode_length = 0;
-	std::array<std::uint8_t, 3> opcode{ };
-
-	bool    has_modrm = false;
-	RM_mode modrm_mod = RM_mode::mem; // Mod R/M address mode
-	std::uint8_t modrm_reg = 0; // Register number or opcode information
-	std::uint8_t modrm_rm  = 0; // Operand register
-
-	bool has_sib = false;
-	std::uint8_t sib_scale = 0;
-	std::uint8_t sib_index = 0;
-	std::uint8_t sib_base  = 0;
-
-	bool has_disp = false;
-	std::int32_t disp_size = 0;
-	std::int32_t disp = 0;
-
-	bool has_imm  = false;
-	bool has_imm2 = false;
-	std::int32_t  imm_size  = 0;
-	std::int32_t  imm2_size = 0;
-	std::uint32_t imm  = 0;
-	std::uint32_t imm2 = 0;
-
 	bool has_rel = false;
-	std::int32_t rel_size = 0;
 	// abs = ip + rel
 	std::int32_t rel = 0;
 
-private:
-	void internal_decode(const std::vector<std::uint8_t>&);
-	void decode_prefixes(const std::vector<std::uint8_t>&);
-	void decode_opcode(const std::vector<std::uint8_t>&);
-	void decode_vex(const std::vector<std::uint8_t>&);
-	void vex_decode_pp(std::uint8_t pp);
-	void vex_decode_mm(std::uint8_t mm);
-	void decode_modrm(const std::vector<std::uint8_t>&);
-	void decode_sib(const std::vector<std::uint8_t>&);
-	void read_disp(const std::vector<std::uint8_t>&);
-	void read_imm(const std::vector<std::uint8_t>&);
-
-	std::uint8_t get_byte(const std::vector<std::uint8_t>& buffer)
-	{
-		if (pos < buffer.size())
-		{
-			length++;
-			return buffer[pos++];
-		}
-		else
-		{
-			signal_error(Error::eof);
-			return 0;
-		}
-	}
+	std::uint8_t error_flags = 0;
+};
 
-	std::uint8_t peek_byte(const std::vector<std::uint8_t>& buffer,
-	                       std::size_t offset = 0) const
-	{
-		return (pos + offset) < buffer.size() ? buffer[pos + offset] : 0;
-	}
+// Length disassembler. Unlike Inst_x86, it doesn't fill in prefixes, Mod R/M,
+// SIB or immediate fields and only reads the immediate if it is relative.
+// Can be evaluated at compile time:
+//   constexpr std::uint8_t stub[] = { 0xe9, 0x00, 0x00, 0x00, 0x00 };
+//   static_assert(ssde::x86_length(stub) == 5, "");
+constexpr Length_x86 x86_decode_length(const std::uint8_t* buffer,
+                                       std::size_t size, std::size_t pos = 0)
+{
+	return detail::decode_length<Mode_x86, Length_x86>(
+		buffer, size, pos,
+		detail::scan_prefixes_scalar<Mode_x86>(buffer, size, pos));
+}
 
-	void signal_error(Error signal)
-	{
-		error_flags |= static_cast<std::uint8_t>(signal);
-	}
+template <std::size_t N>
+constexpr Length_x86 x86_decode_length(const std::uint8_t (&buffer)[N])
+{
+	return x86_decode_length(buffer, N);
+}
 
-	std::size_t pos = 0;
-	std::uint16_t flags = 0;
-	std::uint8_t error_flags = 0;
+constexpr std::int32_t x86_length(const std::uint8_t* buffer, std::size_t size,
+                                 std::size_t pos = 0)
+{
+	return x86_decode_length(buffer, size, pos).length;
+}
+
+template <std::size_t N>
+constexpr std::int32_t x86_length(const std::uint8_t (&buffer)[N])
+{
+	return x86_decode_length(buffer, N).length;
+}
+
+// Struct-of-arrays output of x86_decode_range. Arrays are owned by the
+// caller and must have room for capacity entries. target, has_rel and error
+// are optional and may be left null.
+struct Range_x86
+{
+	std::size_t*  offset  = nullptr; // where instruction starts
+	std::uint8_t* length  = nullptr;
+	std::int64_t* target  = nullptr; // offset + rel, valid if has_rel is set
+	std::uint8_t* has_rel = nullptr;
+	std::uint8_t* error   = nullptr; // Inst_x86::Error flags
+	std::size_t   capacity = 0;
 };
 
+// Linear sweep over [start, end) of buffer. Decodes instructions one after
+// another until end is reached or out is full and returns how many were
+// written. The last instruction may extend past end, but never past size.
+std::size_t x86_decode_range(const std::uint8_t* buffer, std::size_t size,
+                             std::size_t start, std::size_t end,
+                             const Range_x86& out);
+
+// Code to decode with x86_decode_streams: [start, end) of buffer, decoded into
+// out like x86_decode_range would. count is set to how many instructions
+// were written.
+struct Stream_x86
+{
+	const std::uint8_t* buffer = nullptr;
+	std::size_t size  = 0;
+	std::size_t start = 0;
+	std::size_t end   = 0;
+
+	Range_x86 out;
+	std::size_t count = 0;
+};
+
+// Linear sweep over many independent streams (functions, for example).
+// Same result as calling x86_decode_range on each stream, except that code
+// of upcoming streams is prefetched while the current one is decoded.
+void x86_decode_streams(Stream_x86* streams, std::size_t count);
+
+// Boundary predecoder. Marks where instructions start instead of decoding
+// them; bit n of the result is set if an instruction starts at block + n.
+// pos is where the first instruction in the block starts and is left at the
+// first one past the block, which is the pos to pass for the next block.
+// Runs of padding and zeroes are skipped 16 bytes at a time.
+std::uint64_t x86_predecode_block(const std::uint8_t* buffer, std::size_t size,
+                                  std::size_t block, std::size_t& pos);
+
+// Predecodes [start, end) of buffer into one mask per 64 bytes starting at
+// start; starts must have room for (end - start + 63) / 64 masks. Returns
+// where the instruction after the last marked one starts.
+std::size_t x86_predecode(const std::uint8_t* buffer, std::size_t size,
+                          std::size_t start, std::size_t end,
+                          std::uint64_t* starts);
+
 } // namespace ssde
 
 #endif // SSDE_X86_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_X86_FLOW_H
+#define SSDE_X86_FLOW_H
+
+#include "ssde_cfg.h"
+#include "ssde_x86_tables.h"
+#include <cstdint>
+#include <cstddef>
+
+
+// Control flow classification of decoded X86/X64 instructions, shared by
+// the graph builders (ssde_cfg.cpp, ssde_callgraph.cpp).
+// Not a part of the public interface.
+
+namespace ssde
+{
+namespace detail
+{
+
+inline std::uint8_t peek(const std::uint8_t* buffer, std::size_t size,
+                         std::size_t pos)
+{
+	return pos < size ? buffer[pos] : 0;
+}
+
+// Flow of the instruction whose opcode starts at op, that is, past prefixes
+inline Flow classify(const std::uint8_t* buffer, std::size_t size,
+                     std::size_t op)
+{
+	std::uint8_t byte = peek(buffer, size, op);
+	std::uint8_t flow = flow_class::table[byte];
+
+	if (byte == 0x0f)
+		flow = flow_class::table_0f[peek(buffer, size, op + 1)];
+
+	switch (flow)
+	{
+	case flow_class::jc:
+		return Flow::branch;
+
+	case flow_class::jp:
+		return Flow::jump;
+
+	case flow_class::cl:
+		return Flow::call;
+
+	case flow_class::rt:
+		return Flow::ret;
+
+	case flow_class::st:
+		return Flow::stop;
+
+	case flow_class::g5:
+		switch ((peek(buffer, size, op + 1) >> 3) & 0x07)
+		{
+		case 2:
+		case 3:
+			return Flow::call;
+
+		case 4:
+		case 5:
+			return Flow::jump;
+		}
+		return Flow::none;
+	}
+
+	return Flow::none;
+}
+
+// Whether control may leave an instruction other than by falling through
+inline bool ends_block(Flow flow)
+{
+	return flow != Flow::none && flow != Flow::call;
+}
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_X86_FLOW_H
@@ -0,0 +1,391 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_X86_LENGTH_H
+#define SSDE_X86_LENGTH_H
+
+#include "ssde_x86_core.h"
+#include "ssde_x86_tables.h"
+#include <cstdint>
+#include <cstddef>
+
+#if defined(_MSC_VER)
+#define SSDE_INLINE __forceinline
+#else
+#define SSDE_INLINE inline __attribute__((always_inline))
+#endif
+
+
+// Length decoder shared by x86_decode_length and x64_decode_length. All of
+// it is constexpr, so lengths and branch targets of byte sequences known at
+// compile time can be checked with static_assert, see x64_length.
+
+namespace ssde
+{
+namespace detail
+{
+
+// Prefixes in front of an opcode, see Inst_x86_core::decode_prefixes
+struct Prefix_run
+{
+	std::int32_t length = 0;     // number of prefix bytes
+	std::uint8_t group[4] = { }; // first prefix of each group, 0 if none
+	std::uint8_t rex = 0;        // REX prefix right before opcode, 0 if none
+};
+
+template <typename Mode>
+constexpr Prefix_run scan_prefixes_scalar(const std::uint8_t* buffer,
+                                          std::size_t size, std::size_t pos)
+{
+	Prefix_run run;
+
+	for (; run.length < 15 && pos < size; ++run.length, ++pos)
+	{
+		std::uint8_t byte = buffer[pos];
+		std::uint8_t pref = prefix_class::table[Mode::long_mode][byte];
+
+		if (pref == prefix_class::no)
+			break;
+
+		if (pref == prefix_class::rx)
+		{
+			// Unlike all legacy prefixes, if CPU meets multiple of REX
+			// prefixes, it will only take the last one into account.
+
+			run.rex = byte;
+			continue;
+		}
+
+		std::int32_t group = pref - prefix_class::g0;
+
+		if (run.group[group] == 0)
+			run.group[group] = byte;
+
+		// REX prefixes before legacy ones are silently ignored
+		run.rex = 0;
+	}
+
+	return run;
+}
+
+// Prefix run at pos, given next, the run at pos+1. Gives the same result as
+// scan_prefixes_scalar at pos, but only looks at one byte, so that walking
+// a buffer backwards classifies each byte once.
+template <typename Mode>
+constexpr Prefix_run extend_prefixes(const std::uint8_t* buffer,
+                                     std::size_t size, std::size_t pos,
+                                     const Prefix_run& next)
+{
+	std::uint8_t byte = buffer[pos];
+	std::uint8_t pref = prefix_class::table[Mode::long_mode][byte];
+
+	if (pref == prefix_class::no)
+		return Prefix_run{};
+
+	// Run starting here would be cut at 15 bytes, rather than where next ends
+	if (next.length == 15)
+		return scan_prefixes_scalar<Mode>(buffer, size, pos);
+
+	Prefix_run run = next;
+	run.length++;
+
+	if (pref == prefix_class::rx)
+	{
+		// Only survives if no other prefix follows
+		if (next.length == 0)
+			run.rex = byte;
+	}
+	else
+	{
+		run.group[pref - prefix_class::g0] = byte;
+	}
+
+	return run;
+}
+
+// Reads instruction bytes for decode_length
+struct Byte_reader
+{
+	constexpr Byte_reader(const std::uint8_t* in_buffer, std::size_t in_size,
+	                      std::size_t in_pos) :
+		buffer(in_buffer), size(in_size), pos(in_pos)
+	{
+	}
+
+	constexpr std::uint8_t peek(std::size_t offset = 0) const
+	{
+		return (pos + offset) < size ? buffer[pos + offset] : 0;
+	}
+
+	constexpr std::uint8_t get()
+	{
+		if (pos < size)
+			return buffer[pos++];
+
+		eof = true;
+		return 0;
+	}
+
+	constexpr void skip(std::int32_t amount)
+	{
+		if (static_cast<std::size_t>(amount) <= size - pos)
+		{
+			pos += amount;
+		}
+		else
+		{
+			pos = size;
+			eof = true;
+		}
+	}
+
+	const std::uint8_t* buffer;
+	std::size_t size;
+	std::size_t pos;
+	bool eof = false;
+};
+
+// Decodes instruction at pos, whose prefixes were already scanned into run.
+// This is a condensed copy of Inst_x86_core::internal_decode. Bytes are
+// consumed exactly the same way, which makes length equal to the distance
+// pos has moved, and all the fields that don't affect the length are kept
+// in locals or not computed at all.
+// Forced inline, so that callers sweeping over code get the whole decoder
+// in their loop.
+template <typename Mode, typename Length>
+SSDE_INLINE constexpr Length decode_length(const std::uint8_t* buffer,
+                                           std::size_t size, std::size_t pos,
+                                           const Prefix_run& run)
+{
+	using Error = typename Inst_x86_core<Mode>::Error;
+
+	Length inst;
+
+	if (pos >= size)
+	{
+		inst.error_flags = static_cast<std::uint8_t>(Error::eof);
+		return inst;
+	}
+
+	const std::size_t start = pos;
+
+	std::uint8_t error_flags = 0;
+
+	// prefixes, see Inst_x86_core::decode_prefixes
+
+	std::uint8_t prefix_0 = run.group[0];
+	bool has_prefix = (run.group[0] | run.group[1] |
+	                   run.group[2] | run.group[3]) != 0;
+	bool p66 = run.group[2] != 0;
+	bool p67 = run.group[3] != 0;
+	bool has_rex = Mode::long_mode && run.rex != 0;
+	bool rex_W = Mode::long_mode && (run.rex & 0x08);
+
+	Byte_reader in(buffer, size, pos + run.length);
+
+	// opcode, see Inst_x86_core::decode_opcode and decode_vex
+
+	std::uint8_t opcode[3] = { };
+	bool has_vex = false;
+	std::uint8_t byte_0 = in.peek();
+
+	if ((Mode::long_mode || (in.peek(1) & 0xc0) == 0xc0) &&
+	    (byte_0 == 0xc4 ||
+	     byte_0 == 0xc5 ||
+	     byte_0 == 0x62))
+	{
+		has_vex = true;
+
+		if (has_prefix)
+			error_flags |= static_cast<std::uint8_t>(Error::opcode);
+
+		if (has_rex)
+			error_flags |= static_cast<std::uint8_t>(Error::rex);
+
+		in.get();
+
+		std::uint8_t mm = 0x01;
+		std::uint8_t pp = 0x00;
+
+		if (byte_0 == 0xc5)
+		{
+			pp = in.get() & 0x03;
+		}
+		else if (byte_0 == 0xc4)
+		{
+			std::uint8_t byte_1 = in.get();
+			std::uint8_t byte_2 = in.get();
+
+			rex_W = Mode::long_mode && (byte_2 & 0x80);
+
+			mm = byte_1 & 0x1f;
+			pp = byte_2 & 0x03;
+		}
+		else
+		{
+			std::uint8_t byte_1 = in.get();
+			std::uint8_t byte_2 = in.get();
+			std::uint8_t byte_3 = in.get();
+
+			rex_W = Mode::long_mode && (byte_2 & 0x80);
+
+			mm = byte_1 & 0x03;
+			pp = byte_2 & 0x03;
+
+			// no rounding control and L'L selects 1024 bit vector
+			if ((byte_3 & 0x70) == 0x60)
+				error_flags |= static_cast<std::uint8_t>(Error::operand);
+		}
+
+		// opcode bytes from mm field, see Inst_x86_core::vex_decode_mm
+
+		if (mm >= 0x01 && mm <= 0x03)
+			opcode[0] = 0x0f;
+		else
+			error_flags |= static_cast<std::uint8_t>(Error::opcode);
+
+		if (mm == 0x02)
+			opcode[1] = 0x38;
+		else if (mm == 0x03)
+			opcode[1] = 0x3a;
+
+		opcode[opcode[1] != 0 ? 2 : 1] = in.get();
+
+		// prefix bytes from pp field, see Inst_x86_core::vex_decode_pp
+
+		if (pp == 0x01)
+			p66 = true;
+		else if (pp != 0x00)
+			prefix_0 = pp == 0x02 ? 0xf3 : 0xf2;
+	}
+	else
+	{
+		opcode[0] = in.get();
+		opcode[1] = opcode[0] == 0x0f ? in.get() : 0;
+		opcode[2] = (opcode[1] == 0x38 || opcode[1] == 0x3a) ? in.get() : 0;
+	}
+
+	std::uint16_t flags = 0;
+
+	if (opcode[0] != 0x0f)
+		flags = opcodes::table[Mode::long_mode][opcode[0]];
+	else if (opcode[1] == 0x38)
+		flags = opcodes::table_38[opcode[2]];
+	else if (opcode[1] == 0x3a)
+		flags = opcodes::table_3a[opcode[2]];
+	else
+		flags = opcodes::table_0f[opcode[1]];
+
+	if (flags == opcodes::gp)
+		flags = opcodes::table_gp[opcode[0] & 0x01][(in.peek() >> 3) & 0x07];
+
+	if (!has_vex && (flags & opcodes::vx))
+		error_flags |= static_cast<std::uint8_t>(Error::no_vex);
+
+	if (flags == opcodes::error)
+	{
+		inst.length = 1;
+		inst.error_flags = error_flags |
+		                   static_cast<std::uint8_t>(Error::opcode) |
+		                   (in.eof ? static_cast<std::uint8_t>(Error::eof) : 0);
+		return inst;
+	}
+
+	if ((flags & opcodes::mp) && !p66)
+		error_flags |= static_cast<std::uint8_t>(Error::opcode);
+
+	// Mod R/M and SIB, see Inst_x86_core::decode_modrm
+
+	if (flags & opcodes::rm)
+	{
+		std::uint8_t desc = modrm_class::table[p67][in.get()];
+
+		if ((desc & modrm_class::reg) && prefix_0 == 0xf0)
+			error_flags |= static_cast<std::uint8_t>(Error::lock);
+
+		in.skip(((desc & modrm_class::sib) ? 1 : 0) +
+		        (desc & modrm_class::disp_size));
+	}
+	else if (prefix_0 == 0xf0)
+	{
+		error_flags |= static_cast<std::uint8_t>(Error::lock);
+	}
+
+	// moffs, imm or rel, see Inst_x86_core::read_imm
+
+	std::int32_t imm_size  = 0;
+	std::int32_t imm2_size = 0;
+
+	if (flags & opcodes::am)
+	{
+		imm_size = !p67 ? Mode::address_size : Mode::address_size / 2;
+	}
+	else
+	{
+		if (flags & opcodes::i32)
+			imm_size = (rex_W && (flags & opcodes::rw)) ? 8 : !p66 ? 4 : 2;
+
+		if (flags & opcodes::i16)
+			(imm_size != 0 ? imm2_size : imm_size) = 2;
+
+		if (flags & opcodes::i8)
+			(imm_size != 0 ? imm2_size : imm_size) = 1;
+	}
+
+	if (flags & opcodes::rel)
+	{
+		std::uint32_t imm = 0;
+
+		for (std::int32_t i = 0; i < imm_size; ++i)
+			imm |= static_cast<std::uint32_t>(in.get()) << i*8;
+
+		in.skip(imm2_size);
+
+		std::int32_t shift = 32 - imm_size*8;
+
+		inst.rel = static_cast<std::int32_t>(imm << shift) >> shift;
+		inst.rel += static_cast<std::int32_t>(in.pos - start);
+		inst.has_rel = true;
+	}
+	else
+	{
+		in.skip(imm_size + imm2_size);
+	}
+
+	inst.length = static_cast<std::int32_t>(in.pos - start);
+
+	if (inst.length > 15)
+	{
+		inst.length = 15;
+		error_flags |= static_cast<std::uint8_t>(Error::length);
+	}
+
+	if (in.eof)
+		error_flags |= static_cast<std::uint8_t>(Error::eof);
+
+	inst.error_flags = error_flags;
+
+	return inst;
+}
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_X86_LENGTH_H
@@ -0,0 +1,373 @@
+// Copyright (C) 2016, Constantine Shablya.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// * The above copyright notice and this permission notice shall be
+//   included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SSDE_X86_TABLES_H
+#define SSDE_X86_TABLES_H
+
+#include <cstdint>
+
+
+// Opcode, prefix and Mod R/M tables of the X86 decoder. They are constexpr,
+// which lets the length decoder run at compile time, see ssde_x86_length.h.
+// Flow class tables are used by the graph builders, see ssde_x86_flow.h.
+
+namespace ssde
+{
+namespace detail
+{
+
+namespace opcodes
+{
+
+enum : std::uint16_t
+{
+	none = 0,
+
+	rm  = 1 << 0, // expect Mod byte
+	ox  = 1 << 1, // expect Mod opcode extension + change behaviour of REX.B
+	rel = 1 << 2, // instruction's imm is a relative address
+	i8  = 1 << 3, // has  8 bit imm
+	i16 = 1 << 4, // has 16 bit imm
+	i32 = 1 << 5, // has 32 bit imm, which can be turned to 16 with 66 prefix
+	rw  = 1 << 6, // supports REX.W
+	am  = 1 << 7, // instruction uses address mode, imm is a memory address
+	vx  = 1 << 8, // instruction requires a VEX prefix
+	mp  = 1 << 9, // instruction has a mandatory 66 prefix
+	gp  = 1 << 10, // flags depend on Mod R/M reg, look them up in table_gp
+
+	ex  = rm  | ox,
+	r8  = i8  | rel,
+	r32 = i32 | rel,
+
+	error = 0xffff
+};
+
+// 1st opcode flag tables
+// [0]: 32 bit mode
+// [1]: 64 bit mode
+static constexpr std::uint16_t table[2][256] =
+{
+	{
+		//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , error, // 0x
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , none , none , // 1x
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none , // 2x
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none ,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, none , // 3x
+		 none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , // 4x
+		 none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , // 5x
+		 none , none ,  rm  ,  rm  , error, error, error, error,  i32 ,rm|i32,  i8  , rm|i8, none , none , none , none , // 6x
+		  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  , // 7x
+		 rm|i8,rm|i32, rm|i8, rm|i8,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 8x
+		 none , none , none , none , none , none , none , none , none , none,i32|i16, error, none , none , none , none , // 9x
+		  am  ,  am  ,  am  ,  am  , none , none , none , none ,  i8  ,  i32 , none , none , none , none , none , none , // Ax
+		  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 ,  i32 , // Bx
+		 rm|i8, rm|i8,  i16 , none ,  rm  ,  rm  , rm|i8,rm|i32,i16|i8, none ,  i16 , none , none ,  i8  , none , none , // Cx
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i8  , none , none ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Dx
+		  r8  ,  r8  ,  r8  ,  r8  ,  i8  ,  i8  ,  i8  ,  i8  ,  r32 ,  r32,i32|i16,  r8  , none , none , none , none , // Ex
+		 none , none , error, error, none , none ,  gp  ,  gp  , none , none , none , none , none , none ,  rm  ,  rm  , // Fx
+	},
+	{
+		//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error, // 0x
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error, // 1x
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error, // 2x
+		  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error,  rm  ,  rm  ,  rm  ,  rm  ,  i8  ,  i32 , error, error, // 3x
+		 error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 4x
+		 none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , none , // 5x
+		 error, error, error,  rm  , error, error, error, error,  i32 ,rm|i32,  i8  , rm|i8, none , none , none , none , // 6x
+		  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  ,  r8  , // 7x
+		 ex|i8,ex|i32, error, ex|i8,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  ex  , // 8x
+		 none , none , none , none , none , none , none , none , none , none , error, error, none , none , none , none , // 9x
+		  am  ,  am  ,  am  ,  am  , none , none , none , none ,  i8  ,  i32 , none , none , none , none , none , none , // Ax
+		  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,  i8  ,rw|i32,rw|i32,rw|i32,rw|i32,rw|i32,rw|i32,rw|i32,rw|i32, // Bx
+		 ex|i8, ex|i8,  i16 , none , error, error, ex|i8,ex|i32,i16|i8, none ,  i16 , none , none ,  i8  , none , none , // Cx
+		  ex  ,  ex  ,  ex  ,  ex  , error, error, error, none ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  , // Dx
+		  r8  ,  r8  ,  r8  ,  r8  ,  i8  ,  i8  ,  i8  ,  i8  ,  r32 ,  r32 , error,  r8  , none , none , none , none , // Ex
+		 none , none , error, error, none , none ,  gp  ,  gp  , none , none , none , none , none , none ,  rm  ,  ex  , // Fx
+	},
+};
+
+// 2nd opcode flag table
+// 0F xx
+static constexpr std::uint16_t table_0f[256] =
+{
+	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+	  ex  ,  ex  ,  rm  ,  rm  , error, error, none , error, none , none , error, none , error,  rm  , none , error, // 0x
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  ex  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  ex  , // 1x
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  , error,  rm  , error,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 2x
+	 none , none , none , none , none , none , error, none , error, error, error, error, error, error, error, error, // 3x
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 4x
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 5x
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // 6x
+	 rm|i8, ex|i8, ex|i8, ex|i8,  rm  ,  rm  ,  rm  , none ,  rm  ,  rm  , error, error,  rm  ,  rm  ,  rm  ,  rm  , // 7x
+	  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 ,  r32 , // 8x
+	  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  ,  ex  , // 9x
+	 none , none , none ,  rm  , rm|i8,  rm  , error, error, none , none , none ,  rm  , rm|i8,  rm  ,  ex  ,  rm  , // Ax
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , none , ex|i8,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Bx
+	  rm  ,  rm  , rm|i8,  rm  , rm|i8, rm|i8, rm|i8,  ex  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Cx
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Dx
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Ex
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Fx
+};
+
+// 3rd opcode flag table
+// 0F 38 xx
+static constexpr std::uint16_t table_38[256] =
+{
+	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+	  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , vx|rm, vx|rm, error, error, // 0x
+	 mp|rm, error, error, error, mp|rm, mp|rm, error, mp|rm, vx|rm, error, vx|rm, error,  rm  ,  rm  ,  rm  , error, // 1x
+	 mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, error, error, mp|rm, mp|rm, mp|rm, mp|rm, vx|rm, vx|rm, error, error, // 2x
+	 mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, error, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, mp|rm, // 3x
+	 mp|rm, mp|rm, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 4x
+	 error, error, error, error, error, error, error, error, vx|rm, vx|rm, error, error, error, error, error, error, // 5x
+	 error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 6x
+	 error, error, error, error, error, error, error, error, vx|rm, vx|rm, error, error, error, error, error, error, // 7x
+	 mp|rm, mp|rm, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // 8x
+	 error, error, error, error, error, error, vx|rm, vx|rm, vx|rm, error, vx|rm, error, vx|rm, error, vx|rm, error, // 9x
+	 error, error, error, error, error, error, vx|rm, vx|rm, vx|rm, error, vx|rm, error, vx|rm, error, vx|rm, error, // Ax
+	 error, error, error, error, error, error, vx|rm, vx|rm, vx|rm, error, vx|rm, error, vx|rm, error, vx|rm, error, // Bx
+	 error, error, error, error, error, error, error, error,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , error, error, // Cx
+	 error, error, error, error, error, error, error, error, error, error, error,  rm  ,  rm  ,  rm  ,  rm  ,  rm  , // Dx
+	 error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, error, // Ex
+	  rm  ,  rm  , error, error, error, error,  rm  , error, error, error, error, error, error, error, error, error, // Fx
+};
+
+// 3rd opcode flag table
+// 0F 3A xx
+static constexpr std::uint16_t table_3a[256] =
+{
+	// x0   |   x1   |   x2   |   x3   |   x4   |   x5   |   x6   |   x7   |   x8   |   x9   |   xA   |   xB   |   xC   |   xD   |   xE   |   xF
+	  error ,  error ,  error ,  error ,  error ,  error ,vx|rm|i8,  error ,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,   rm   , // 0x
+	  error ,  error ,  error ,  error ,mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,vx|rm|i8,vx|rm|i8,  error ,  error ,  error ,  error ,  error ,  error , // 1x
+	mp|rm|i8,mp|rm|i8,mp|rm|i8,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 2x
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 3x
+	  mp|rm ,  mp|rm ,mp|rm|i8,  error ,  error ,  error ,  error ,  error ,  error ,  error ,vx|rm|i8,vx|rm|i8,vx|rm|i8,  error ,  error ,  error , // 4x
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 5x
+	mp|rm|i8,mp|rm|i8,mp|rm|i8,mp|rm|i8,  error ,  error ,  error ,  error ,vx|rm|i8,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 6x
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 7x
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 8x
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // 9x
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Ax
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Bx
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,mp|rm|i8,  error ,  error ,  error , // Cx
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Dx
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Ex
+	  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error ,  error , // Fx
+};
+
+// Mod R/M reg extended opcode flag table
+// F6 /r and F7 /r
+static constexpr std::uint16_t table_gp[2][8] =
+{
+	//  /0  |   /1   |  /2  |  /3  |  /4  |  /5  |  /6  |  /7
+	{ rm|i8 , rm|i8  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  }, // F6
+	{ rm|i32, rm|i32 ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  ,  rm  }, // F7
+};
+
+} // namespace opcodes
+
+namespace prefix_class
+{
+
+enum : std::uint8_t
+{
+	no = 0, // not a prefix
+	g0 = 1, // LOCK, REPNZ and REPZ prefixes
+	g1 = 2, // segment prefixes and branch hints
+	g2 = 3, // operand size override prefix
+	g3 = 4, // address size override prefix
+	rx = 5, // REX prefix
+};
+
+// Prefix class tables, one entry per byte
+// [0]: 32 bit mode, 4x are INC and DEC
+// [1]: 64 bit mode
+static constexpr std::uint8_t table[2][256] =
+{
+	{
+		//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 0x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 1x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  , // 2x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  , // 3x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 4x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 5x
+		  no  ,  no  ,  no  ,  no  ,  g1  ,  g1  ,  g2  ,  g3  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 6x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 7x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 8x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 9x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ax
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Bx
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Cx
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Dx
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ex
+		  g0  ,  no  ,  g0  ,  g0  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Fx
+	},
+	{
+		//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 0x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 1x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  , // 2x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g1  ,  no  , // 3x
+		  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  ,  rx  , // 4x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 5x
+		  no  ,  no  ,  no  ,  no  ,  g1  ,  g1  ,  g2  ,  g3  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 6x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 7x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 8x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 9x
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ax
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Bx
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Cx
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Dx
+		  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ex
+		  g0  ,  no  ,  g0  ,  g0  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Fx
+	},
+};
+
+} // namespace prefix_class
+
+namespace modrm_class
+{
+
+enum : std::uint8_t
+{
+	mem = 0,      // [r]
+	d8  = 1,      // [r]+disp8
+	d16 = 2,      // [r]+disp16
+	d32 = 4,      // [r]+disp32
+	sib = 1 << 3, // SIB byte follows
+	reg = 1 << 4, // r
+
+	disp_size = 0x07,
+};
+
+// Mod R/M descriptor tables, indexed by Mod R/M byte
+// [0]: 32 bit addressing
+// [1]: 16 bit addressing (67 prefix)
+static constexpr std::uint8_t table[2][256] =
+{
+	{
+		//x0     |    x1   |    x2   |    x3   |    x4   |    x5   |    x6   |    x7   |    x8   |    x9   |    xA   |    xB   |    xC   |    xD   |    xE   |    xF
+		   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   , // 0x
+		   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   , // 1x
+		   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   , // 2x
+		   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   sib   ,   d32   ,   mem   ,   mem   , // 3x
+		    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   , // 4x
+		    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   , // 5x
+		    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   , // 6x
+		    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,  sib|d8 ,    d8   ,    d8   ,    d8   , // 7x
+		   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   , // 8x
+		   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   , // 9x
+		   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   , // Ax
+		   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   ,   d32   , sib|d32 ,   d32   ,   d32   ,   d32   , // Bx
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Cx
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Dx
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Ex
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Fx
+	},
+	{
+		//x0     |    x1   |    x2   |    x3   |    x4   |    x5   |    x6   |    x7   |    x8   |    x9   |    xA   |    xB   |    xC   |    xD   |    xE   |    xF
+		   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   , // 0x
+		   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   , // 1x
+		   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   , // 2x
+		   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   mem   ,   d16   ,   mem   , // 3x
+		    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   , // 4x
+		    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   , // 5x
+		    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   , // 6x
+		    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   ,    d8   , // 7x
+		   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   , // 8x
+		   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   , // 9x
+		   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   , // Ax
+		   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   ,   d16   , // Bx
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Cx
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Dx
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Ex
+		   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   ,   reg   , // Fx
+	},
+};
+
+} // namespace modrm_class
+
+namespace flow_class
+{
+
+enum : std::uint8_t
+{
+	no = 0, // falls through to the next instruction
+	jc = 1, // conditional branch
+	jp = 2, // unconditional jump
+	cl = 3, // call
+	rt = 4, // return
+	st = 5, // stops execution (HLT, UD2, INT3)
+	g5 = 6, // 0xff group, depends on Mod R/M reg: 2, 3 call; 4, 5 jump
+};
+
+// Flow class of 1st opcode byte. 9A and EA only exist in 32 bit mode, in
+// 64 bit mode they fail to decode.
+static constexpr std::uint8_t table[256] =
+{
+	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 0x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 1x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 2x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 3x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 4x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 5x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 6x
+	  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  , // 7x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 8x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  cl  ,  no  ,  no  ,  no  ,  no  ,  no  , // 9x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ax
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Bx
+	  no  ,  no  ,  rt  ,  rt  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  rt  ,  rt  ,  st  ,  no  ,  no  ,  rt  , // Cx
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Dx
+	  jc  ,  jc  ,  jc  ,  jc  ,  no  ,  no  ,  no  ,  no  ,  cl  ,  jp  ,  jp  ,  jp  ,  no  ,  no  ,  no  ,  no  , // Ex
+	  no  ,  no  ,  no  ,  no  ,  st  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  g5  , // Fx
+};
+
+// Flow class of 2nd opcode byte, after 0F
+static constexpr std::uint8_t table_0f[256] =
+{
+	//x0  |  x1  |  x2  |  x3  |  x4  |  x5  |  x6  |  x7  |  x8  |  x9  |  xA  |  xB  |  xC  |  xD  |  xE  |  xF
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  rt  ,  no  ,  no  ,  no  ,  st  ,  no  ,  no  ,  no  ,  no  , // 0x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 1x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 2x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  rt  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 3x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 4x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 5x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 6x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 7x
+	  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  ,  jc  , // 8x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // 9x
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ax
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  st  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Bx
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Cx
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Dx
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  , // Ex
+	  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  no  ,  st  , // Fx
+};
+
+} // namespace flow_class
+
+} // namespace detail
+} // namespace ssde
+
+#endif // SSDE_X86_TABLES_H